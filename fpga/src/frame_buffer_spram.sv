@@ -1,6 +1,12 @@
 // ----------------------------------------------------------------------------
 // Async FIFO Frame Buffer (Double Buffered SPRAM) with Serial Readout
 // Target: Lattice iCE40 UP5K (Uses SB_SPRAM256KA)
+//
+// Frame format (must match mcu/segger_project/config.h):
+//   pixel p = y*320 + x is bit p[3:0] of SPRAM word p[16:4]; each row is 20
+//   words. Words go out in address order, each one LSB first. The MCU reads
+//   16-bit LSB-first SPI frames, so pixel x lands in bit x%32 of little-endian
+//   word x/32 of its row.
 // ----------------------------------------------------------------------------
 
 module frame_buffer_spram (
@@ -15,14 +21,17 @@ module frame_buffer_spram (
     // Read Interface (System Domain 48 MHz + MCU Interface)
     input  wire        r_clk,          // 48 MHz system clock
     input  wire        i_mcu_sck,      // Clock line from MCU (Continuous or Gated)
+    input  wire        i_mcu_cs_n,     // Transaction select from MCU (active low)
+    input  wire        i_mcu_cmd,      // Band request header from MCU (SPI MOSI)
     output reg         o_mcu_mosi,     // Data line to MCU (Serial Data)
     
     // Status
-    output reg         frame_ready     // High while valid frame data is available (Logic High = Valid)
+    output reg         frame_ready     // High from bank swap until the MCU reads a "last" band
 );
 
     // ------------------------------------------------------------------------
     // 1. Pixel Packing (Camera Domain)
+    // Pixel N of each 16-pixel group goes to bit N (LSB = leftmost pixel)
     // ------------------------------------------------------------------------
     reg [15:0] shifter;
     reg        word_write_req;
@@ -113,73 +122,314 @@ module frame_buffer_spram (
     // Trigger on Bank Swap (Frame Done)
     wire frame_swap_event = (bank_sync[2] != prev_bank_sync);
 
-    // -- MCU Clock Sampling (CDC) --
+    // -- MCU Clock / Select / Command Sampling (CDC) --
+    // All three go through the same 3-stage chain so they stay aligned
     reg [2:0] mcu_sck_sync;
+    reg [2:0] mcu_cs_sync;
+    reg [2:0] mcu_cmd_sync;
     always @(posedge r_clk) begin
         mcu_sck_sync <= {mcu_sck_sync[1:0], i_mcu_sck};
+        mcu_cs_sync  <= {mcu_cs_sync[1:0], i_mcu_cs_n};
+        mcu_cmd_sync <= {mcu_cmd_sync[1:0], i_mcu_cmd};
     end
 
     wire mcu_sck_falling = (mcu_sck_sync[2:1] == 2'b10); 
+    wire mcu_sck_rising  = (mcu_sck_sync[2:1] == 2'b01);
+    wire mcu_selected    = !mcu_cs_sync[1];
+    wire mcu_cs_falling  = (mcu_cs_sync[2:1] == 2'b10);
+
+    // -- Band Request (Region of Interest) --
+    // Every CS-low transaction starts with a 32-bit header on i_mcu_cmd, sent
+    // LSB first and sampled on SCK rising edges (SPI mode 0):
+    //   [7:0]   first row  (0-239)
+    //   [15:8]  row count  (0 = through the last row)
+    //   [16]    last band of this frame: drop frame_ready when it is sent
+    //   [17]    test pattern: send pattern_word() instead of the frame, used
+    //           by the MCU to calibrate the link rate. Leaves frame_ready
+    //           alone and survives bank swaps.
+    //   [31:18] reserved, send 0
+    // The serializer then sends rows [first, first + count), a 32-bit info
+    // word, a 32-bit CRC of everything before it, and pads with 0s until CS
+    // goes high. A bank swap abandons any band in flight.
+    //
+    // Info word, latched when the header completes:
+    //   [15:0]  frame sequence, bank swaps since reset (gaps = frames the MCU
+    //           never read)
+    //   [31:16] frame age, microseconds since that swap, saturating
+    //
+    // CRC: CRC-32 polynomial 0x04C11DB7, init 0xFFFFFFFF, no final XOR, run
+    // over the payload and info bits in the order they go out. The result is sent like
+    // a data word pair, bit 0 first, so the MCU reads it as a little-endian
+    // uint32_t. The MCU's CRC unit with word input reversal gives the same.
+    localparam [2:0] S_IDLE   = 3'd0,   // Waiting for CS to fall
+                     S_HEADER = 3'd1,   // Shifting in the band request
+                     S_STREAM = 3'd2,   // Shifting band words out
+                     S_INFO   = 3'd3,   // Shifting the info word out
+                     S_CRC    = 3'd4,   // Shifting the band CRC out
+                     S_DONE   = 3'd5;   // Band sent, padding until CS rises
+
+    localparam [31:0] CRC_POLY = 32'h04C11DB7;
+
+    localparam [8:0] ROWS = 9'd240;
+
+    // Row -> first SPRAM word of that row (20 words per row)
+    function [12:0] row_to_word(input [8:0] row);
+        row_to_word = {row, 4'b0000} + {2'b00, row, 2'b00};
+    endfunction
+
+    // Calibration pattern, must match SPI1_Pattern_Word() on the MCU
+    function [15:0] pattern_word(input [12:0] addr);
+        pattern_word = {~addr[7:0], addr[7:0]} ^ 16'h5555;
+    endfunction
+
+    // -- Frame Sequence & Age --
+    reg [15:0] frame_seq;
+    reg [15:0] frame_age;       // us since the last swap
+    reg [5:0]  age_div;         // r_clk cycles into the current us
+
+    always @(posedge r_clk) begin
+        if (!w_rst_n) begin
+            frame_seq <= 16'd0;
+            frame_age <= 16'hFFFF;
+            age_div <= 6'd0;
+        end else if (frame_swap_event) begin
+            frame_seq <= frame_seq + 1'b1;
+            frame_age <= 16'd0;
+            age_div <= 6'd0;
+        end else if (age_div == 6'd47) begin
+            age_div <= 6'd0;
+            if (frame_age != 16'hFFFF) frame_age <= frame_age + 1'b1;
+        end else begin
+            age_div <= age_div + 1'b1;
+        end
+    end
+
+    reg [2:0]  rd_state;
+    reg [31:0] cmd_shift;
+    reg [4:0]  cmd_bits;
+    reg        band_last;
+    reg        band_pattern;
+    reg [31:0] band_info;       // Info word of the band in flight
+
+    wire [31:0] cmd_next  = {mcu_cmd_sync[1], cmd_shift[31:1]};
+    wire [8:0]  hdr_first = {1'b0, cmd_next[7:0]};
+    wire [8:0]  hdr_sum   = hdr_first + {1'b0, cmd_next[15:8]};
+    wire [8:0]  hdr_end   = (cmd_next[15:8] == 8'd0 || hdr_sum > ROWS) ? ROWS : hdr_sum;
 
     // -- Read Pointers & Data Path --
-    reg [12:0] r_addr_word;     // Current word address (0-4799)
+    // One word is shifting out while the next one is prefetched, so a new
+    // word is on the line right after the 16th falling edge.
+    reg [12:0] cur_addr;        // Word in output_shift_reg
+    reg [12:0] r_end_word;      // Last word of the requested band
     reg [3:0]  bit_idx;         // Current bit index (0-15)
     reg [15:0] output_shift_reg;
+    reg        cur_valid;
+    reg        bit_sampled;     // MCU has seen the current bit (rising edge)
+
+    reg [12:0] fetch_addr;      // Next word to read from SPRAM
+    reg        fetch_req;       // Waiting for a read slot (writes win)
+    reg        fetch_issued;    // SPRAM latched fetch_addr on the last edge
+    reg [15:0] next_word;
+    reg        next_valid;
     wire [15:0] spram_data_out; 
-    reg load_new_word; 
-    
-    // Flag to indicate we reached the end of the frame
-    reg frame_complete;
+
+    reg [31:0] band_crc;        // Running CRC, then shifted out in S_CRC
+    reg [4:0]  crc_bits;        // Trailer bits sent, info word then CRC
+    wire [31:0] crc_next = {band_crc[30:0], 1'b0} ^ ((band_crc[31] ^ o_mcu_mosi) ? CRC_POLY : 32'd0);
+
+    // A pattern band "fetches" from pattern_word() on the same schedule
+    wire [15:0] fetch_data = band_pattern ? pattern_word(fetch_addr) : spram_data_out;
+
+    wire fetch_room = !cur_valid || !next_valid;
+    wire pattern_busy = band_pattern && (rd_state == S_STREAM || rd_state == S_INFO || rd_state == S_CRC);
+    wire word_done  = cur_valid && bit_sampled && mcu_sck_falling && (bit_idx == 4'd15);
 
     always @(posedge r_clk) begin
         if (!w_rst_n) begin
             frame_ready <= 1'b0;
-            r_addr_word <= 13'd0;
+            rd_state <= S_IDLE;
+            cmd_bits <= 5'd0;
+            band_last <= 1'b0;
+            band_pattern <= 1'b0;
+            cur_addr <= 13'd0;
+            r_end_word <= 13'd0;
             bit_idx <= 4'd0;
+            cur_valid <= 1'b0;
+            bit_sampled <= 1'b0;
+            fetch_addr <= 13'd0;
+            fetch_req <= 1'b0;
+            fetch_issued <= 1'b0;
+            next_valid <= 1'b0;
+            band_crc <= 32'hFFFFFFFF;
+            crc_bits <= 5'd0;
             o_mcu_mosi <= 1'b0;
-            frame_complete <= 1'b0;
         end else begin
+            // A read slot is only lost to a camera write, so retry until free
+            fetch_issued <= fetch_req && !sys_write_en;
+            if (fetch_req && !sys_write_en) fetch_req <= 1'b0;
+
             // PRIORITY 1: New Frame Arrived
-            // Reset everything immediately, regardless of MCU clock state
-            if (frame_swap_event) begin
-                r_addr_word <= 13'd0;
-                bit_idx <= 4'd0;
-                load_new_word <= 1'b1; // Fetch first word
+            // Reset everything immediately, regardless of MCU clock state.
+            // A pattern band doesn't read the banks, so it carries on.
+            if (frame_swap_event && !pattern_busy) begin
+                rd_state <= S_IDLE;
+                cur_valid <= 1'b0;
+                next_valid <= 1'b0;
+                fetch_req <= 1'b0;
+                fetch_issued <= 1'b0;
+                o_mcu_mosi <= 1'b0;
+            end
+
+            // PRIORITY 2: MCU deselected, drop whatever was going on
+            else if (!mcu_selected) begin
+                rd_state <= S_IDLE;
+                cur_valid <= 1'b0;
+                next_valid <= 1'b0;
+                fetch_req <= 1'b0;
+                fetch_issued <= 1'b0;
                 o_mcu_mosi <= 1'b0;
-                
-                // Assert Ready Flag
-                frame_ready <= 1'b1; 
-                frame_complete <= 1'b0;
-            end 
-            
-            // PRIORITY 2: Load Data from SPRAM
-            else if (load_new_word) begin
-                output_shift_reg <= spram_data_out;
-                load_new_word <= 1'b0;
-                o_mcu_mosi <= spram_data_out[0]; // Output bit 0 immediately
             end
-            
-            // PRIORITY 3: Shift Data on MCU Clock
-            else if (mcu_sck_falling && !frame_complete) begin
-                
-                // --- Shifting Logic ---
-                if (bit_idx == 4'd15) begin
-                    bit_idx <= 4'd0;
-                    
-                    if (r_addr_word < 13'd4799) begin
-                        r_addr_word <= r_addr_word + 1'b1;
-                        load_new_word <= 1'b1; // Trigger fetch for next word
+
+            else begin
+                case (rd_state)
+                S_IDLE: begin
+                    if (mcu_cs_falling) begin
+                        cmd_bits <= 5'd0;
+                        rd_state <= S_HEADER;
+                    end
+                end
+
+                S_HEADER: begin
+                    if (mcu_sck_rising) begin
+                        cmd_shift <= cmd_next;
+                        cmd_bits <= cmd_bits + 1'b1;
+
+                        if (cmd_bits == 5'd31) begin
+                            band_last <= cmd_next[16] && !cmd_next[17];
+                            band_pattern <= cmd_next[17];
+                            band_info <= {frame_age, frame_seq};
+                            band_crc <= 32'hFFFFFFFF;
+                            if (hdr_first >= ROWS) begin
+                                // Empty band
+                                rd_state <= S_DONE;
+                                if (cmd_next[16] && !cmd_next[17]) frame_ready <= 1'b0;
+                            end else begin
+                                cur_addr <= row_to_word(hdr_first);
+                                fetch_addr <= row_to_word(hdr_first);
+                                r_end_word <= row_to_word(hdr_end) - 1'b1;
+                                fetch_req <= 1'b1;
+                                cur_valid <= 1'b0;
+                                next_valid <= 1'b0;
+                                rd_state <= S_STREAM;
+                            end
+                        end
+                    end
+                end
+
+                S_STREAM: begin
+                    // Keep one read in flight while there is room for it
+                    if (!fetch_req && !fetch_issued && fetch_room && fetch_addr <= r_end_word) begin
+                        fetch_req <= 1'b1;
+                    end
+
+                    if (word_done) begin
+                        // --- Word boundary: move on to the next word ---
+                        bit_idx <= 4'd0;
+                        bit_sampled <= 1'b0;
+
+                        if (cur_addr == r_end_word) begin
+                            // End of band reached, the info word follows
+                            rd_state <= S_INFO;
+                            cur_valid <= 1'b0;
+                            crc_bits <= 5'd0;
+                            o_mcu_mosi <= band_info[0];
+                        end else begin
+                            cur_addr <= cur_addr + 1'b1;
+                            if (next_valid) begin
+                                output_shift_reg <= next_word;
+                                o_mcu_mosi <= next_word[0];
+                                next_valid <= fetch_issued;
+                                if (fetch_issued) next_word <= fetch_data;
+                            end else if (fetch_issued) begin
+                                output_shift_reg <= fetch_data;
+                                o_mcu_mosi <= fetch_data[0];
+                            end else begin
+                                // Prefetch starved by writes; resume when it lands
+                                cur_valid <= 1'b0;
+                            end
+                        end
+                        if (fetch_issued) fetch_addr <= fetch_addr + 1'b1;
                     end else begin
-                        // End of Frame Reached
-                        frame_complete <= 1'b1;
-                        o_mcu_mosi <= 1'b0; // Output 0s as padding
-                        frame_ready <= 1'b0; // Drop flag when data is exhausted
+                        // --- Fetch landed: shift register first, then prefetch slot ---
+                        if (fetch_issued) begin
+                            fetch_addr <= fetch_addr + 1'b1;
+                            if (!cur_valid) begin
+                                output_shift_reg <= fetch_data;
+                                o_mcu_mosi <= fetch_data[0]; // Output bit 0 immediately
+                                cur_valid <= 1'b1;
+                                bit_idx <= 4'd0;
+                                bit_sampled <= 1'b0;
+                            end else begin
+                                next_word <= fetch_data;
+                                next_valid <= 1'b1;
+                            end
+                        end
+
+                        // --- Shifting Logic (LSB first, see header) ---
+                        if (cur_valid) begin
+                            if (mcu_sck_rising && !bit_sampled) begin
+                                bit_sampled <= 1'b1;
+                                band_crc <= crc_next;
+                            end else if (mcu_sck_falling && bit_sampled) begin
+                                bit_sampled <= 1'b0;
+                                bit_idx <= bit_idx + 1'b1;
+                                o_mcu_mosi <= output_shift_reg[bit_idx + 1];
+                            end
+                        end
+                    end
+                end
+
+                S_INFO: begin
+                    // Still part of the CRC, like the payload
+                    if (mcu_sck_rising && !bit_sampled) begin
+                        bit_sampled <= 1'b1;
+                        band_crc <= crc_next;
+                    end else if (mcu_sck_falling && bit_sampled) begin
+                        bit_sampled <= 1'b0;
+                        crc_bits <= crc_bits + 1'b1;
+                        if (crc_bits == 5'd31) begin
+                            rd_state <= S_CRC;
+                            o_mcu_mosi <= band_crc[0];
+                        end else begin
+                            o_mcu_mosi <= band_info[crc_bits + 1];
+                        end
                     end
-                end else begin
-                    bit_idx <= bit_idx + 1'b1;
-                    o_mcu_mosi <= output_shift_reg[bit_idx + 1]; 
                 end
+
+                S_CRC: begin
+                    if (mcu_sck_rising) begin
+                        bit_sampled <= 1'b1;
+                    end else if (mcu_sck_falling && bit_sampled) begin
+                        bit_sampled <= 1'b0;
+                        crc_bits <= crc_bits + 1'b1;
+                        if (crc_bits == 5'd31) begin
+                            rd_state <= S_DONE;
+                            o_mcu_mosi <= 1'b0; // Output 0s as padding
+                            if (band_last) frame_ready <= 1'b0;
+                        end else begin
+                            o_mcu_mosi <= band_crc[crc_bits + 1];
+                        end
+                    end
+                end
+
+                S_DONE: begin
+                    o_mcu_mosi <= 1'b0;
+                end
+                endcase
             end
+
+            // Last so a swap always wins over a band dropping frame_ready
+            if (frame_swap_event) frame_ready <= 1'b1;
         end
     end
 
@@ -192,7 +442,7 @@ module frame_buffer_spram (
 
     assign spram_wren = sys_write_en;
     assign spram_data_in = sys_w_data;
-    assign spram_addr = sys_write_en ? {sys_w_bank, sys_w_addr} : {r_bank_sel, r_addr_word};
+    assign spram_addr = sys_write_en ? {sys_w_bank, sys_w_addr} : {r_bank_sel, fetch_addr};
     
     SP256K spram_inst (
         .AD(spram_addr),      
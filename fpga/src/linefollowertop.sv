@@ -4,7 +4,11 @@
 // ----------------------------------------------------------------------------
 // Interfaces:
 // 1. OV7670 Camera (Input)
-// 2. MCU Interface (SPI-like Slave Output)
+// 2. MCU Interface (SPI-like Slave: row-band request in, band data out)
+//
+// The robot carries two camera/FPGA pairs, one per side, running this same
+// design. They share SCK, MOSI and MISO; each has its own select and
+// frame_ready line, and only drives MISO while selected.
 // ============================================================================
 
 module camera_line_follower_top (
@@ -20,10 +24,14 @@ module camera_line_follower_top (
     // MCU Interface
     // 1. Clock Line (Input from MCU)
     input  wire mcu_clk_in,         
-    // 2. Data Line (Output to MCU - Serial Stream)
+    // 2. Data Line (Output to MCU - Serial Stream, high-Z when deselected)
     output wire mcu_data_out,       
     // 3. Frame Ready Line (Output - Toggles on new frame)
     output wire mcu_frame_ready,
+    // 4. Select Line (Input from MCU - frames each band request)
+    input  wire mcu_cs_n,
+    // 5. Command Line (Input from MCU - band request header)
+    input  wire mcu_cmd_in,
 
     // Debug / LEDs (Optional)
     output wire led_frame_indicator // Toggles with frame ready
@@ -68,6 +76,7 @@ module camera_line_follower_top (
     // ------------------------------------------------------------------------
     // Frame Buffer & Serializer (System Domain)
     // ------------------------------------------------------------------------
+    wire mcu_miso;
     
     frame_buffer_spram framebuffer (
         // Write Side (Camera)
@@ -81,10 +90,15 @@ module camera_line_follower_top (
         // Read Side (MCU)
         .r_clk(clk_48mhz),          // Internal high speed clock
         .i_mcu_sck(mcu_clk_in),     // MCU provides the clock
-        .o_mcu_mosi(mcu_data_out),  // FPGA sends the data
+        .i_mcu_cs_n(mcu_cs_n),      // MCU frames each band request
+        .i_mcu_cmd(mcu_cmd_in),     // MCU picks the rows to send
+        .o_mcu_mosi(mcu_miso),      // FPGA sends the data
         .frame_ready(mcu_frame_ready)
     );
 
+    // Release the shared data line to the other FPGA while not selected
+    assign mcu_data_out = mcu_cs_n ? 1'bz : mcu_miso;
+
     assign led_frame_indicator = mcu_frame_ready;
 
 endmodule
\ No newline at end of file
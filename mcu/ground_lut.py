@@ -0,0 +1,120 @@
+"""Generate segger_project/ground_lut.c, the inverse-perspective tables.
+
+The camera looks down at a flat floor with no roll, so every pixel of an
+image row sees the floor at the same distance ahead, and one pixel step
+along the row is the same floor width anywhere on that row. Two values per
+row are therefore enough to map any (row, column) to floor coordinates:
+
+    forward (mm ahead of the camera)    = forward_q4[row] / 16
+    lateral (mm right of the camera)    = (column - cx) * mm_per_px_q12[row] / 4096
+
+The firmware does only that multiply; all the trig happens here. Rerun this
+after moving the camera or changing the lens, and commit the output.
+"""
+
+import argparse
+import math
+import os
+
+# --- CONFIGURATION ---
+# Measured on the robot; pass --height etc. to override
+CAMERA_HEIGHT_MM = 120.0    # Lens centre above the floor
+CAMERA_PITCH_DEG = 40.0     # Optical axis below horizontal
+FOCAL_X_PX = 290.0          # OV7670 at QVGA, ~57 deg horizontal field of view
+FOCAL_Y_PX = 290.0
+CENTRE_X_PX = 160.0         # Principal point, pixel edges (pixel x spans [x, x + 1))
+CENTRE_Y_PX = 120.0
+MAX_RANGE_MM = 4000.0       # Rows that see the floor further away than this are left out
+
+IMAGE_WIDTH = 320
+IMAGE_HEIGHT = 240
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "segger_project", "ground_lut.c")
+# ---------------------
+
+
+def row_geometry(row, height, pitch, fy, cy):
+    """Depth along the optical axis at which the centre ray of an image row
+    meets the floor, and how far ahead of the camera that is. None if the
+    row sees the horizon or the sky."""
+    b = (row + 0.5 - cy) / fy                   # Ray slope below the optical axis
+    down = b * math.cos(pitch) + math.sin(pitch)
+    if down <= 0.0:
+        return None
+    t = height / down
+    return t, t * (math.cos(pitch) - b * math.sin(pitch))
+
+
+def build_tables(args):
+    pitch = math.radians(args.pitch)
+    forward_q4 = []
+    mm_per_px_q12 = []
+
+    for row in range(IMAGE_HEIGHT):
+        geom = row_geometry(row, args.height, pitch, args.fy, args.cy)
+        if geom is None or geom[1] > args.max_range:
+            forward_q4.append(0)
+            mm_per_px_q12.append(0)
+            continue
+        t, forward = geom
+        f = int(round(forward * 16))
+        s = int(round(t / args.fx * 4096))
+        if not 0 < f <= 0xFFFF or not 0 < s <= 0xFFFF:
+            raise SystemExit(f"row {row}: forward {forward:.1f} mm or {t / args.fx:.2f} mm/px "
+                             "does not fit 16 bits, lower --max-range")
+        forward_q4.append(f)
+        mm_per_px_q12.append(s)
+
+    return forward_q4, mm_per_px_q12
+
+
+def c_array(values, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("        " + ", ".join(f"{v:5d}" for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def write_source(path, args, forward_q4, mm_per_px_q12):
+    first = next((r for r, f in enumerate(forward_q4) if f), IMAGE_HEIGHT)
+    text = f"""// ground_lut.c
+// Generated by mcu/ground_lut.py, do not edit: rerun it after changing the
+// camera mount.
+// Camera: {args.height:g} mm above the floor, pitched {args.pitch:g} deg down, fx {args.fx:g},
+// fy {args.fy:g}, principal point ({args.cx:g}, {args.cy:g}), range {args.max_range:g} mm.
+// Rows {first} to {IMAGE_HEIGHT - 1} see the floor.
+#include "ground.h"
+
+const GroundLut ground_lut = {{
+    .centre_x_q8 = {int(round(args.cx * 256))},
+    .forward_q4 = {{
+{c_array(forward_q4)}
+    }},
+    .mm_per_px_q12 = {{
+{c_array(mm_per_px_q12)}
+    }},
+}};
+"""
+    with open(path, "w", newline="\n") as f:
+        f.write(text)
+    print(f"Wrote {path}: rows {first}..{IMAGE_HEIGHT - 1}, "
+          f"{forward_q4[-1] / 16:.0f}..{forward_q4[first] / 16:.0f} mm ahead")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--height", type=float, default=CAMERA_HEIGHT_MM, help="camera height, mm")
+    parser.add_argument("--pitch", type=float, default=CAMERA_PITCH_DEG, help="pitch below horizontal, degrees")
+    parser.add_argument("--fx", type=float, default=FOCAL_X_PX, help="focal length, pixels")
+    parser.add_argument("--fy", type=float, default=FOCAL_Y_PX)
+    parser.add_argument("--cx", type=float, default=CENTRE_X_PX, help="principal point, pixels")
+    parser.add_argument("--cy", type=float, default=CENTRE_Y_PX)
+    parser.add_argument("--max-range", type=float, default=MAX_RANGE_MM, help="furthest floor distance kept, mm")
+    parser.add_argument("--output", default=OUTPUT)
+    args = parser.parse_args()
+
+    forward_q4, mm_per_px_q12 = build_tables(args)
+    write_source(args.output, args, forward_q4, mm_per_px_q12)
+
+
+if __name__ == "__main__":
+    main()
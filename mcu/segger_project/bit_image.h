@@ -0,0 +1,101 @@
+// bit_image.h
+#ifndef BIT_IMAGE_H
+#define BIT_IMAGE_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include <stdbool.h>
+
+// Pixel x of a row in its word: LSB first is the canonical frame format
+// (config.h). The kernels only take LSB-first views; MSB first is there so
+// BitImage_GetPixel() can read foreign buffers.
+typedef enum {
+    BIT_ORDER_LSB_FIRST = 0,
+    BIT_ORDER_MSB_FIRST = 1
+} BitOrder;
+
+// A view of a packed bitmap: a whole frame, a band of its rows, a window of
+// it, or a pyramid level. Rows are stride words apart; pixel (0, 0) of the
+// view is the first pixel of base[0]. Views are cut on word boundaries, so
+// they never need a bit offset. x, y say where the view sits in the image
+// it was cut from, for kernels that need frame coordinates.
+typedef struct {
+    uint32_t *base;
+    uint16_t width;             // Pixels
+    uint16_t height;            // Rows
+    uint16_t stride;            // Words from one row to the next
+    uint16_t x, y;              // Origin in the parent image
+    BitOrder order;
+} BitImage;
+
+static inline BitImage BitImage_Make(uint32_t *base, uint16_t width, uint16_t height, uint16_t stride)
+{
+    BitImage img = { base, width, height, stride, 0, 0, BIT_ORDER_LSB_FIRST };
+    return img;
+}
+
+// A whole IMAGE_WIDTH x IMAGE_HEIGHT frame buffer
+static inline BitImage BitImage_Frame(const void *data)
+{
+    return BitImage_Make((uint32_t *)data, IMAGE_WIDTH, IMAGE_HEIGHT, IMAGE_ROW_WORDS);
+}
+
+// Rectangle [x, x + width) x [y, y + height) of img, clipped to it. x is
+// rounded down to a word, widening the view by up to 31 pixels on the left.
+static inline BitImage BitImage_Sub(const BitImage *img, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    BitImage sub = *img;
+
+    if (x > img->width) x = img->width;
+    if (y > img->height) y = img->height;
+    if (width > img->width - x) width = img->width - x;
+    if (height > img->height - y) height = img->height - y;
+
+    uint16_t x_word = x & ~31U;
+    sub.base = img->base + (uint32_t)y * img->stride + x_word / 32;
+    sub.width = width + (x - x_word);
+    sub.height = height;
+    sub.x = img->x + x_word;
+    sub.y = img->y + y;
+    return sub;
+}
+
+// Full-width band of rows, the shape streamed chunks and ROI bands have
+static inline BitImage BitImage_Rows(const BitImage *img, uint16_t first_row, uint16_t num_rows)
+{
+    return BitImage_Sub(img, 0, first_row, img->width, num_rows);
+}
+
+static inline uint32_t *BitImage_Row(const BitImage *img, uint16_t r)
+{
+    return img->base + (uint32_t)r * img->stride;
+}
+
+// Words a row of the view spans
+static inline uint16_t BitImage_RowWords(const BitImage *img)
+{
+    return (img->width + 31U) / 32U;
+}
+
+// Bits of a row's last word that belong to the view
+static inline uint32_t BitImage_LastMask(const BitImage *img)
+{
+    uint32_t bits = img->width & 31U;
+    return bits ? ((1U << bits) - 1U) : 0xFFFFFFFFU;
+}
+
+// Rows are back to back with no partial word, so the view is one run of words
+static inline bool BitImage_Contiguous(const BitImage *img)
+{
+    return (img->width & 31U) == 0 && img->stride == img->width / 32U;
+}
+
+// Single pixel, for the few places that really need one
+static inline uint32_t BitImage_GetPixel(const BitImage *img, uint16_t x, uint16_t y)
+{
+    uint32_t word = img->base[(uint32_t)y * img->stride + (x >> 5)];
+    uint32_t bit = (img->order == BIT_ORDER_LSB_FIRST) ? (x & 31U) : (31U - (x & 31U));
+    return (word >> bit) & 1U;
+}
+
+#endif // BIT_IMAGE_H
@@ -0,0 +1,143 @@
+// bit_kernels.c
+#include "bit_kernels.h"
+#include <stddef.h>
+
+// ============================================================================
+// Internal Helpers
+// ============================================================================
+
+// First two SWAR steps: bit counts per nibble, each field <= 4
+static inline uint32_t nibble_counts(uint32_t w)
+{
+    w = w - ((w >> 1) & 0x55555555U);
+    return (w & 0x33333333U) + ((w >> 2) & 0x33333333U);
+}
+
+// ============================================================================
+// Population Counts
+// ============================================================================
+
+// Three words share the nibble stage (fields <= 12), up to eight triples
+// share the byte stage (fields <= 192), and one fold per 24 words replaces
+// the per-word multiply. About 6 ops per word against 12 for
+// BitKernel_Popcount() on each.
+uint32_t BitKernel_PopcountWords(const uint32_t *words, uint32_t num_words)
+{
+    uint32_t total = 0;
+    uint32_t i = 0;
+
+    while (i + 3 <= num_words) {
+        uint32_t bytes = 0;
+        for (uint32_t g = 0; g < 8 && i + 3 <= num_words; g++, i += 3) {
+            uint32_t n = nibble_counts(words[i]) + nibble_counts(words[i + 1])
+                       + nibble_counts(words[i + 2]);
+            bytes += (n & 0x0F0F0F0FU) + ((n >> 4) & 0x0F0F0F0FU);
+        }
+        uint32_t halves = (bytes & 0x00FF00FFU) + ((bytes >> 8) & 0x00FF00FFU);
+        total += (halves + (halves >> 16)) & 0xFFFFU;
+    }
+    for (; i < num_words; i++) {
+        total += BitKernel_Popcount(words[i]);
+    }
+    return total;
+}
+
+// Set pixels in a view. A full-width band of a frame is one run of words;
+// anything else goes row by row with the last word masked.
+uint32_t BitKernel_PopcountImage(const BitImage *img)
+{
+    if (img->width == 0) return 0;
+    if (BitImage_Contiguous(img)) {
+        return BitKernel_PopcountWords(img->base, (uint32_t)img->height * img->stride);
+    }
+
+    uint32_t words = BitImage_RowWords(img);
+    uint32_t last_mask = BitImage_LastMask(img);
+    uint32_t count = 0;
+    for (uint16_t r = 0; r < img->height; r++) {
+        const uint32_t *row = BitImage_Row(img, r);
+        count += BitKernel_PopcountWords(row, words - 1) + BitKernel_Popcount(row[words - 1] & last_mask);
+    }
+    return count;
+}
+
+// Set pixels in the rectangle [x, x + width) x [y, y + height) of a view,
+// clipped to it. Only the first and last word of each row need a mask.
+uint32_t BitKernel_PopcountRegion(const BitImage *img, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    if (x >= img->width || y >= img->height || width == 0 || height == 0) return 0;
+
+    uint32_t x_end = (uint32_t)x + width;
+    uint32_t y_end = (uint32_t)y + height;
+    if (x_end > img->width) x_end = img->width;
+    if (y_end > img->height) y_end = img->height;
+
+    uint32_t first_word = x >> 5;
+    uint32_t last_word = (x_end - 1) >> 5;
+    uint32_t last_bits = ((x_end - 1) & 31) + 1;
+    uint32_t first_mask = BitKernel_SpanMask(x & 31, (first_word == last_word) ? last_bits : 32);
+    uint32_t last_mask = BitKernel_SpanMask(0, last_bits);
+    uint32_t count = 0;
+
+    for (uint32_t r = y; r < y_end; r++) {
+        const uint32_t *row = BitImage_Row(img, r);
+        count += BitKernel_Popcount(row[first_word] & first_mask);
+        if (last_word > first_word) {
+            count += BitKernel_PopcountWords(row + first_word + 1, last_word - first_word - 1);
+            count += BitKernel_Popcount(row[last_word] & last_mask);
+        }
+    }
+    return count;
+}
+
+uint32_t BitKernel_PopcountMasked(const uint32_t *words, const uint32_t *mask, uint32_t num_words)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < num_words; i++) {
+        count += BitKernel_Popcount(words[i] & mask[i]);
+    }
+    return count;
+}
+
+// ============================================================================
+// Logic Ops
+// ============================================================================
+
+void BitKernel_And(uint32_t *dst, const uint32_t *src, const uint32_t *mask, uint32_t num_words)
+{
+    if (mask == NULL) {
+        for (uint32_t i = 0; i < num_words; i++) dst[i] &= src[i];
+    } else {
+        for (uint32_t i = 0; i < num_words; i++) dst[i] &= src[i] | ~mask[i];
+    }
+}
+
+void BitKernel_Or(uint32_t *dst, const uint32_t *src, const uint32_t *mask, uint32_t num_words)
+{
+    if (mask == NULL) {
+        for (uint32_t i = 0; i < num_words; i++) dst[i] |= src[i];
+    } else {
+        for (uint32_t i = 0; i < num_words; i++) dst[i] |= src[i] & mask[i];
+    }
+}
+
+void BitKernel_Xor(uint32_t *dst, const uint32_t *src, const uint32_t *mask, uint32_t num_words)
+{
+    if (mask == NULL) {
+        for (uint32_t i = 0; i < num_words; i++) dst[i] ^= src[i];
+    } else {
+        for (uint32_t i = 0; i < num_words; i++) dst[i] ^= src[i] & mask[i];
+    }
+}
+
+void BitKernel_RowMask(uint32_t mask[IMAGE_ROW_WORDS], uint16_t x0, uint16_t x1)
+{
+    if (x1 > IMAGE_WIDTH) x1 = IMAGE_WIDTH;
+
+    for (uint32_t w = 0; w < IMAGE_ROW_WORDS; w++) {
+        uint32_t lo = w * 32;
+        uint32_t start = (x0 > lo) ? x0 - lo : 0;
+        uint32_t end = (x1 < lo + 32) ? ((x1 > lo) ? x1 - lo : 0) : 32;
+        mask[w] = (start < end) ? BitKernel_SpanMask(start, end) : 0;
+    }
+}
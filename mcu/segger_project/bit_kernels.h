@@ -0,0 +1,53 @@
+// bit_kernels.h
+#ifndef BIT_KERNELS_H
+#define BIT_KERNELS_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "bit_image.h"
+
+// Word-parallel kernels on the packed frame format (see config.h): pixel x of
+// a row is bit x % 32 of word x / 32. Images come as BitImage views. A set
+// bit is a line (black) pixel, as count_white_pixels() assumes. Everything
+// works on 32 pixels per operation; nothing here touches single pixels.
+
+// SWAR population count: 12 ALU ops, no table, no branch. The M4 has no
+// popcount instruction.
+static inline uint32_t BitKernel_Popcount(uint32_t w)
+{
+    w = w - ((w >> 1) & 0x55555555U);
+    w = (w & 0x33333333U) + ((w >> 2) & 0x33333333U);
+    w = (w + (w >> 4)) & 0x0F0F0F0FU;
+    return (w * 0x01010101U) >> 24;
+}
+
+// Set bits per byte, each count in its own byte (0..8). Up to 31 of these
+// can be summed before a byte overflows.
+static inline uint32_t BitKernel_ByteCounts(uint32_t w)
+{
+    w = w - ((w >> 1) & 0x55555555U);
+    w = (w & 0x33333333U) + ((w >> 2) & 0x33333333U);
+    return (w + (w >> 4)) & 0x0F0F0F0FU;
+}
+
+// Bits [x0, x1) of a word, 0 <= x0 < x1 <= 32
+static inline uint32_t BitKernel_SpanMask(uint32_t x0, uint32_t x1)
+{
+    uint32_t hi = (x1 >= 32) ? 0xFFFFFFFFU : ((1U << x1) - 1U);
+    return hi & ~((1U << x0) - 1U);
+}
+
+uint32_t BitKernel_PopcountWords(const uint32_t *words, uint32_t num_words);
+uint32_t BitKernel_PopcountImage(const BitImage *img);
+uint32_t BitKernel_PopcountRegion(const BitImage *img, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+uint32_t BitKernel_PopcountMasked(const uint32_t *words, const uint32_t *mask, uint32_t num_words);
+
+// dst = dst OP src, only where mask is set (mask NULL = everywhere)
+void BitKernel_And(uint32_t *dst, const uint32_t *src, const uint32_t *mask, uint32_t num_words);
+void BitKernel_Or(uint32_t *dst, const uint32_t *src, const uint32_t *mask, uint32_t num_words);
+void BitKernel_Xor(uint32_t *dst, const uint32_t *src, const uint32_t *mask, uint32_t num_words);
+
+// Row-sized mask with pixels [x0, x1) set, for the masked ops
+void BitKernel_RowMask(uint32_t mask[IMAGE_ROW_WORDS], uint16_t x0, uint16_t x1);
+
+#endif // BIT_KERNELS_H
@@ -1,121 +1,180 @@
 #include "camera_capture.h"
 
-// Definition of shared buffers
-uint8_t image_buffer[IMAGE_SIZE_BYTES];
-volatile uint32_t pixel_count = 0;
+#if CAPTURE_PARALLEL
 
-void capture_frame(void)
+// Raw GPIOA->IDR[7:0] samples, one per PCLK falling edge. The DMA runs
+// circular over it while capture_frame() packs behind the write pointer.
+static uint8_t raw_samples[DMA_RAW_BUFFER_SIZE] __attribute__((aligned(4)));
+static DMA_HandleTypeDef hdma_pclk;
+
+// Bit positions of the sampled pins inside the low IDR byte
+#define RAW_VALID_MASK  ((uint8_t)DATA_VALID_PIN)
+#define RAW_DATA_SHIFT  __builtin_ctz(PIXEL_DATA_PIN)
+
+typedef struct {
+    uint32_t *out;          // Next bitmap word
+    const uint32_t *end;
+    uint32_t word;          // Bits collected for *out, LSB first
+    uint32_t bits;
+} PackState;
+
+static inline void pack_bits(PackState *ps, uint32_t value, uint32_t count)
 {
-    uint32_t timeout;
-    uint32_t gpio_state;
-    uint32_t prev_gpio;
-    
-    // Optimization: Local variables for buffering
-    uint8_t *p_buffer = image_buffer; 
-    uint8_t current_byte = 0;
-    int8_t bit_index = 7; // MSB first (7 down to 0)
-    
-    // Clear buffer and counter
-    // Note: Using memset here is fine as it happens before the time-critical loop
-    memset(image_buffer, 0, IMAGE_SIZE_BYTES);
-    pixel_count = 0;
-    
-    // 1. Wait for frame to start (FRAME_ACTIVE goes HIGH)
-    timeout = 10000000;
-    while (!(GPIOA->IDR & FRAME_ACTIVE_PIN)) {
-        if (--timeout == 0) {
-            printf("ERROR: Timeout waiting for frame start\r\n");
-            return;
-        }
+    ps->word |= value << ps->bits;
+    ps->bits += count;
+    if (ps->bits >= 32) {
+        *ps->out++ = ps->word;
+        ps->bits -= 32;
+        ps->word = ps->bits ? value >> (count - ps->bits) : 0;
+    }
+}
+
+// Appends the pixel bit of every sample taken while DATA_VALID was high.
+// Four samples at a time: in the common case (inside a line) all four are
+// valid and their data bits are gathered into a nibble with one multiply.
+static void pack_samples(PackState *ps, const uint8_t *raw, uint32_t count)
+{
+    while (count >= 4 && ((uintptr_t)raw & 3) != 0) {
+        if (*raw & RAW_VALID_MASK) pack_bits(ps, (*raw >> RAW_DATA_SHIFT) & 1, 1);
+        raw++;
+        count--;
+        if (ps->out >= ps->end) return;
     }
-   
-    // Read initial GPIO state
-    prev_gpio = GPIOA->IDR;
-
-    
-    // 2. Fast Capture Loop
-    // We use a pointer to IDR to ensure the compiler optimizes the read address
-    volatile uint32_t *IDR_Reg = &(GPIOA->IDR);
-
-    while (*IDR_Reg & FRAME_ACTIVE_PIN)
-    {
-        gpio_state = *IDR_Reg;
-        
-        // Detect PCLK Falling Edge (Current High && Previous Low)
-        // We use bitwise logic strictly on registers here
-        if (!(gpio_state & PCLK_PIN) && (prev_gpio & PCLK_PIN))
-        {
-            // Check if data is valid (HREF/Write Enable)
-            if (gpio_state & DATA_VALID_PIN)
-            {
-                // If pixel data is High, set the specific bit in our local register
-                if (gpio_state & PIXEL_DATA_PIN) {
-                    current_byte |= (1 << bit_index);
-                }
-
-                // Move to next bit
-                bit_index--;
-
-                // If we have collected 8 bits, flush to RAM
-                if (bit_index < 0) {
-                    *p_buffer = current_byte; // Write byte to RAM
-                    p_buffer++;               // Increment pointer
-                    
-                    // Reset for next byte
-                    current_byte = 0;
-                    bit_index = 7;
-                    
-                    // Safety check to prevent buffer overflow
-                    if (p_buffer >= (image_buffer + IMAGE_SIZE_BYTES)) break;
-                }
-                
-                pixel_count++;
+
+    const uint32_t valid4 = RAW_VALID_MASK * 0x01010101UL;
+    while (count >= 4) {
+        uint32_t w = *(const uint32_t *)raw;
+        if ((w & valid4) == valid4) {
+            // Data bits at 0, 8, 16, 24 -> bits 24..27, no carries into them
+            uint32_t b = (w >> RAW_DATA_SHIFT) & 0x01010101UL;
+            pack_bits(ps, (uint32_t)(b * 0x01020408UL) >> 24, 4);
+        } else if (w & valid4) {
+            for (int i = 0; i < 4; i++) {
+                uint8_t sample = raw[i];
+                if (sample & RAW_VALID_MASK) pack_bits(ps, (sample >> RAW_DATA_SHIFT) & 1, 1);
             }
         }
-        prev_gpio = gpio_state;
+        raw += 4;
+        count -= 4;
+        if (ps->out >= ps->end) return;
+    }
+
+    while (count--) {
+        if (*raw & RAW_VALID_MASK) pack_bits(ps, (*raw >> RAW_DATA_SHIFT) & 1, 1);
+        raw++;
+        if (ps->out >= ps->end) return;
     }
 }
 
+// Parallel-pin fallback for when the FPGA's SPI path is not available.
+// PCLK (PA9) is input capture on TIM1_CH2, and every falling edge makes
+// DMA1_Channel3 copy GPIOA->IDR[7:0] (DATA_VALID PA5, PIXEL_DATA PA6) into
+// raw_samples, so the sampling rate no longer depends on a software loop.
+// TIM1 must already be running (XCLK_Init()). PA9 is also the left motor's
+// forward output, so main.c only drives the right motor on this path.
+void capture_dma_init(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
 
-void capture_frame_spi(void)
+    GPIO_InitStruct.Pin = DATA_VALID_PIN | PIXEL_DATA_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+    GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    GPIO_InitStruct.Pin = PCLK_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Alternate = GPIO_AF1_TIM1;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    // TIM1_CH2 is DMA1 Channel 3, request 7
+    hdma_pclk.Instance = DMA1_Channel3;
+    hdma_pclk.Init.Request = DMA_REQUEST_7;
+    hdma_pclk.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_pclk.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_pclk.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_pclk.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_pclk.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_pclk.Init.Mode = DMA_CIRCULAR;
+    hdma_pclk.Init.Priority = DMA_PRIORITY_HIGH;    // Below the SPI RX channel
+
+    if (HAL_DMA_Init(&hdma_pclk) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // CH2 as input capture on TI2, falling edge, no filter or prescaler.
+    // CH4 keeps generating XCLK, the channels are independent.
+    TIM1->CCER &= ~TIM_CCER_CC2E;
+    TIM1->CCMR1 = (TIM1->CCMR1 & ~(TIM_CCMR1_CC2S | TIM_CCMR1_IC2F | TIM_CCMR1_IC2PSC))
+                | TIM_CCMR1_CC2S_0;
+    TIM1->CCER = (TIM1->CCER & ~TIM_CCER_CC2NP) | TIM_CCER_CC2P | TIM_CCER_CC2E;
+}
+
+void capture_frame(FrameDescriptor *frame)
 {
-    memset(image_buffer, 0, IMAGE_SIZE_BYTES);
-    uint8_t *p_buffer = image_buffer;
-    const uint8_t *p_end = image_buffer + IMAGE_SIZE_BYTES;
-    
-    // 1. Pointers for speed
-    // Cast DR to uint8_t* is CRITICAL on L4 to force 8-bit access
-    volatile uint8_t *SPI_DR_8b = (__IO uint8_t *)&SPI1->DR;
-    volatile uint32_t *SPI_SR   = &SPI1->SR;
-    
-    // ADJUST THIS IF FRAME PIN IS NOT ON PORT A
-    volatile uint32_t *GPIO_Frame_IDR = &(GPIOA->IDR); 
-    pixel_count = 0;
-    // 2. Wait for FPGA to signal Ready (High)
-    while (!(*GPIO_Frame_IDR & FRAME_ACTIVE_PIN));
-    
-
-    // 3. Enable SPI (Starts Clock Generation immediately in RXONLY mode)
-    // Note: We don't need to re-configure CR2/FRXTH because HAL_SPI_Init already did it.
-    SPI1->CR1 |= SPI_CR1_SPE; 
-
-    // 4. Capture Loop
-    while (*GPIO_Frame_IDR & FRAME_ACTIVE_PIN)
-    {
-        // Wait for FIFO to have at least 8 bits (RXNE)
-        if (*SPI_SR & SPI_SR_RXNE)
-        {
-            *p_buffer++ = *SPI_DR_8b;
-            if (p_buffer >= p_end) break;
-            pixel_count += 8;
-        }
+    PackState ps = {
+        .out = (uint32_t *)frame->data,
+        .end = (const uint32_t *)frame->data + IMAGE_SIZE_WORDS,
+        .word = 0,
+        .bits = 0
+    };
+    uint32_t read_idx = 0;
+
+    // No clear needed: every word counted in valid_bytes is fully written
+    frame->valid_bytes = 0;
+
+    uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+    uint32_t start = DWT->CYCCNT;
+
+    // 1. Wait for frame to start (FRAME_ACTIVE goes HIGH)
+    while (!(GPIOA->IDR & FRAME_ACTIVE_PIN)) {
+        if (DWT->CYCCNT - start > CAPTURE_WAIT_TIMEOUT_MS * cycles_per_ms) return;
     }
+    start = DWT->CYCCNT;
+    // Pixels arrive as they are read off the sensor
+    frame->exposed_at = start;
+    frame->started_at = start;
 
-    // 5. Stop Clock
-    SPI1->CR1 &= ~SPI_CR1_SPE; 
-    
-    // Flush any extra bytes sitting in FIFO so they don't corrupt next frame
-    while (*SPI_SR & SPI_SR_RXNE) {
-        (void)*SPI_DR_8b;
+    // 2. Let PCLK edges drive the DMA
+    if (HAL_DMA_Start(&hdma_pclk, (uint32_t)&GPIOA->IDR, (uint32_t)raw_samples,
+                      DMA_RAW_BUFFER_SIZE) != HAL_OK) {
+        return;
     }
-}
\ No newline at end of file
+    TIM1->SR = ~TIM_SR_CC2IF;
+    TIM1->DIER |= TIM_DIER_CC2DE;
+
+    // 3. Pack behind the DMA write pointer until the frame ends. The raw
+    // buffer covers ~0.8 ms of PCLK at 2.5 MHz; packing needs far less, but
+    // an interrupt that holds this loop off for longer will lose samples.
+    while (ps.out < ps.end) {
+        // Sample the pin first so the samples taken before it dropped are
+        // still packed on this pass
+        bool active = (GPIOA->IDR & FRAME_ACTIVE_PIN) != 0;
+        uint32_t write_idx = (DMA_RAW_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&hdma_pclk))
+                           % DMA_RAW_BUFFER_SIZE;
+
+        if (write_idx < read_idx) {
+            pack_samples(&ps, &raw_samples[read_idx], DMA_RAW_BUFFER_SIZE - read_idx);
+            read_idx = 0;
+        }
+        pack_samples(&ps, &raw_samples[read_idx], write_idx - read_idx);
+        read_idx = write_idx;
+
+        if (!active) break;
+        // Short valid_bytes tells the caller the frame is partial
+        if (DWT->CYCCNT - start > CAPTURE_PARALLEL_TIMEOUT_MS * cycles_per_ms) break;
+    }
+
+    // 4. Stop sampling
+    TIM1->DIER &= ~TIM_DIER_CC2DE;
+    HAL_DMA_Abort(&hdma_pclk);
+
+    frame->valid_bytes = (uint8_t *)ps.out - frame->data;
+    frame->timestamp = DWT->CYCCNT;
+}
+
+#endif // CAPTURE_PARALLEL
@@ -3,14 +3,16 @@
 #include <stdint.h>
 #include "main.h"
 #include "config.h"
+#include "frame_pool.h"
 #include <stdio.h>
 #include <string.h>
 
-// Shared data
-extern uint8_t image_buffer[IMAGE_SIZE_BYTES];
-extern volatile uint32_t pixel_count;
-
-void capture_frame(void);
-void capture_frame_spi(void);
+// Blocking parallel-pin capture, reports what it wrote in frame->valid_bytes.
+// Only built with CAPTURE_PARALLEL, which is what main.c then captures with;
+// the SPI link is read by SpiControlHandshake.
+#if CAPTURE_PARALLEL
+void capture_dma_init(void);
+void capture_frame(FrameDescriptor *frame);
+#endif
 
 #endif
\ No newline at end of file
@@ -1,40 +1,28 @@
 #include "camera_vision.h"
+#include "bit_kernels.h"
+#include "line_projection.h"
+#include "row_runs.h"
+#include "vision_timing.h"
 #include <stdio.h>
 #include "SEGGER_RTT.h"
 
 // Get pixel value at (x, y) - returns 0 or 1
-uint8_t get_pixel(uint16_t x, uint16_t y)
+uint8_t get_pixel(const uint8_t *frame, uint16_t x, uint16_t y)
 {
     if (x >= IMAGE_WIDTH || y >= IMAGE_HEIGHT) return 0;
-    uint32_t pixel_index = y * IMAGE_WIDTH + x;
-    uint32_t byte_idx = pixel_index >> 3;
-    uint32_t bit_idx = 7 - (pixel_index & 0x07);
-   
-   return (image_buffer[byte_idx] >> bit_idx) & 0x01;
+    BitImage img = BitImage_Frame(frame);
+    return (uint8_t)BitImage_GetPixel(&img, x, y);
 }
 
-void visualize_image_compact(void)
+uint32_t visualize_image_compact(const uint8_t *frame)
 {
-    ////printf("=== COMPACT VIEW (Center Rows) ===\r\n\r\n");
-    uint16_t start_row = 0;
-    uint16_t end_row = IMAGE_HEIGHT;
-    uint32_t black_pixels = 0;
-    uint32_t white_pixels = 0;
-    for (uint16_t y = start_row; y < end_row; y += 1) {
-        ////printf("%3d: ", y);
-        for (uint16_t x = 0; x < IMAGE_WIDTH; x += 1) {
-            uint8_t pixel = get_pixel(x, y);
-            black_pixels += pixel;
-            if(pixel == 0) white_pixels += 1;
-            ////printf("%c", pixel ? ' ' : '#');
-        }
-       
-    }
-    return white_pixels;
+    return count_white_pixels(frame);
 }
 
 
-void image_to_file(void)
+// Telemetry only reads the frame, so it can run on a retained frame while
+// capture carries on with the rest of the pool
+void image_to_file(const FrameDescriptor *frame)
 {
     // 1. CRITICAL: Enable Blocking Mode
     // If the 1KB buffer fills up, the STM32 will PAUSE here until the 
@@ -49,17 +37,20 @@ void image_to_file(void)
     // 3. Send Image Data (Row by Row)
     // Buffer size: 320 * 2 chars + newline + null terminator = 642
     char line_buffer[650]; 
+    const uint32_t *words = (const uint32_t *)frame->data;
     
     for (uint16_t y = 0; y < IMAGE_HEIGHT; y++) 
     {
         int pos = 0;
-        for (uint16_t x = 0; x < IMAGE_WIDTH; x++) 
+        // Walk each word's bits LSB first (pixel order) instead of indexing every pixel
+        for (uint16_t w = 0; w < IMAGE_ROW_WORDS; w++) 
         {
-            uint8_t pixel = get_pixel(x, y);
-            
-            // Unrolling this slightly manually to avoid s//printf overhead in the inner loop
-            line_buffer[pos++] = pixel ? '1' : '0';
-            line_buffer[pos++] = ' ';
+            uint32_t bits = *words++;
+            for (uint8_t b = 0; b < 32; b++, bits >>= 1) 
+            {
+                line_buffer[pos++] = (bits & 1U) ? '1' : '0';
+                line_buffer[pos++] = ' ';
+            }
         }
         line_buffer[pos++] = '\n'; // End of row
         
@@ -71,14 +62,111 @@ void image_to_file(void)
     SEGGER_RTT_Write(0, "\n", 1);
 }
 
-uint32_t count_white_pixels(void) {
-    uint32_t white_pixels = IMAGE_HEIGHT * IMAGE_WIDTH;
-    // go through every byte
+uint32_t count_white_pixels(const uint8_t *frame) {
+    return count_white_pixels_rows(frame, 0, IMAGE_HEIGHT);
+}
+
+// Same count over a band of rows, so it can run on a frame still being streamed in
+uint32_t count_white_pixels_rows(const uint8_t *frame, uint16_t first_row, uint16_t num_rows) {
+    BitImage img = BitImage_Frame(frame);
+    BitImage band = BitImage_Rows(&img, first_row, num_rows);
+    return (uint32_t)band.height * IMAGE_WIDTH - BitKernel_PopcountImage(&band);
+}
+
+// Per-stage cycle counts from live frames (see vision_timing.h)
+VisionTiming vision_timing;
+
+#if VISION_BENCHMARK
+// ============================================================================
+// Benchmark: the per-bit code the word kernels replaced
+// ============================================================================
+
+VisionBenchmark vision_benchmark_result;
+
+// Old count_white_pixels_rows() inner loop, 8 shifts per byte
+static uint32_t count_white_per_bit(const uint8_t *frame) {
+    uint32_t white_pixels = IMAGE_SIZE_PIXELS;
     for (size_t i = 0; i < IMAGE_SIZE_BYTES; ++i) {
-        // check every bit in each byte
         for (size_t j = 0; j < 8; ++j) {
-            white_pixels -= ((image_buffer[i] >> j) & 0x01);
+            white_pixels -= ((frame[i] >> j) & 0x01);
+        }
+    }
+    return white_pixels;
+}
+
+// Old visualize_image_compact(), one indexed lookup per pixel
+static uint32_t count_white_get_pixel(const uint8_t *frame) {
+    uint32_t white_pixels = 0;
+    for (uint16_t y = 0; y < IMAGE_HEIGHT; y++) {
+        for (uint16_t x = 0; x < IMAGE_WIDTH; x++) {
+            uint32_t pixel_index = y * IMAGE_WIDTH + x;
+            if (((frame[pixel_index >> 3] >> (pixel_index & 0x07)) & 0x01) == 0) white_pixels++;
         }
     }
     return white_pixels;
-}
\ No newline at end of file
+}
+
+// Row runs the way the old code would find edges, one get_pixel() per pixel
+static uint32_t count_runs_get_pixel(const uint8_t *frame) {
+    uint32_t runs = 0;
+    for (uint16_t y = 0; y < IMAGE_HEIGHT; y++) {
+        uint8_t prev = 0;
+        for (uint16_t x = 0; x < IMAGE_WIDTH; x++) {
+            uint8_t pixel = get_pixel(frame, x, y);
+            if (pixel && !prev) runs++;
+            prev = pixel;
+        }
+    }
+    return runs;
+}
+
+// Times one frame through each version and prints the cycle counts on RTT.
+// All three must agree, or the result is flagged. proj and runs are the
+// caller's, already used for this frame; both are overwritten.
+void vision_benchmark(const uint8_t *frame, LineProjection *proj, RowRunList *runs) {
+    VisionBenchmark *r = &vision_benchmark_result;
+    uint32_t start;
+
+    start = DWT->CYCCNT;
+    uint32_t per_bit = count_white_per_bit(frame);
+    r->per_bit_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    uint32_t indexed = count_white_get_pixel(frame);
+    r->get_pixel_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    uint32_t words = count_white_pixels(frame);
+    r->word_cycles = DWT->CYCCNT - start;
+
+    BitImage img = BitImage_Frame(frame);
+    LineEstimate est;
+    start = DWT->CYCCNT;
+    LineProjection_Clear(proj);
+    LineProjection_AddRows(proj, &img);
+    LineProjection_Estimate(proj, &est);
+    r->projection_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    RowRuns_Extract(runs, &img, NULL);
+    r->runs_cycles = DWT->CYCCNT - start;
+    r->num_runs = runs->num_runs;
+
+    start = DWT->CYCCNT;
+    uint32_t slow_runs = count_runs_get_pixel(frame);
+    r->get_pixel_runs_cycles = DWT->CYCCNT - start;
+    r->mismatch = (per_bit != words || indexed != words)
+               || (!runs->truncated && slow_runs != runs->num_runs);
+
+    char line[128];
+    int len = snprintf(line, sizeof(line), "popcount/frame: per-bit %lu  get_pixel %lu  words %lu  projection %lu cycles%s\n",
+                       (unsigned long)r->per_bit_cycles, (unsigned long)r->get_pixel_cycles,
+                       (unsigned long)r->word_cycles, (unsigned long)r->projection_cycles,
+                       r->mismatch ? "  MISMATCH" : "");
+    SEGGER_RTT_Write(0, line, len);
+
+    len = snprintf(line, sizeof(line), "runs/frame: %u runs, get_pixel %lu  clz %lu cycles\n",
+                   r->num_runs, (unsigned long)r->get_pixel_runs_cycles, (unsigned long)r->runs_cycles);
+    SEGGER_RTT_Write(0, line, len);
+}
+#endif
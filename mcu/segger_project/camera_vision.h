@@ -3,11 +3,40 @@
 
 #include "main.h"
 #include "config.h"
-#include "camera_capture.h" // Needs access to image_buffer
+#include "frame_pool.h"
+#include <stdbool.h>
 
-uint8_t get_pixel(uint16_t x, uint16_t y);
-void visualize_image_compact(void);
-void image_to_file(void);
-uint32_t count_black_pixels(void);
+// What Robot_Control_Side() runs on a frame: every row, or only the
+// lookahead rows (see scan_lines.h)
+typedef enum {
+    VISION_FULL = 0,
+    VISION_SPARSE = 1
+} VisionMode;
+
+uint8_t get_pixel(const uint8_t *frame, uint16_t x, uint16_t y);
+uint32_t visualize_image_compact(const uint8_t *frame);
+void image_to_file(const FrameDescriptor *frame);
+uint32_t count_white_pixels(const uint8_t *frame);
+uint32_t count_white_pixels_rows(const uint8_t *frame, uint16_t first_row, uint16_t num_rows);
+
+#if VISION_BENCHMARK
+#include "line_projection.h"
+#include "row_runs.h"
+
+// DWT cycles for one full-frame white count, old per-bit code against the word kernels
+typedef struct {
+    uint32_t per_bit_cycles;
+    uint32_t get_pixel_cycles;
+    uint32_t word_cycles;
+    uint32_t projection_cycles;     // Column projection and line estimate, full frame
+    uint32_t runs_cycles;           // Row run extraction, full frame
+    uint32_t get_pixel_runs_cycles; // Same runs found with get_pixel()
+    uint16_t num_runs;
+    bool mismatch;
+} VisionBenchmark;
+
+extern VisionBenchmark vision_benchmark_result;
+void vision_benchmark(const uint8_t *frame, LineProjection *proj, RowRunList *runs);
+#endif
 
 #endif // CAMERA_VISION_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+// components.c
+#include "components.h"
+#include "vision_timing.h"
+#include <string.h>
+
+// ============================================================================
+// Union-Find
+// ============================================================================
+
+// Path halving; roots are always the lowest run index of their set, so a
+// root comes before every run it owns
+static uint16_t find(uint16_t *parent, uint16_t i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void unite(uint16_t *parent, uint16_t a, uint16_t b)
+{
+    a = find(parent, a);
+    b = find(parent, b);
+    if (a < b) parent[b] = a;
+    else if (b < a) parent[a] = b;
+}
+
+// x * 256 / d without overflowing for sums up to 2^32 / 256 * d
+static uint32_t div_q8(uint32_t x, uint32_t d)
+{
+    return ((x / d) * 256U + ((x % d) * 256U) / d);
+}
+
+// ============================================================================
+// Labelling
+// ============================================================================
+
+// Runs of neighbouring rows belong together when they overlap or touch
+// diagonally (8-connectivity). Each row pair is one merge-style sweep, so
+// the whole pass is linear in the number of runs; the bitmap isn't touched.
+//   1. Union overlapping runs of each row with the row above
+//   2. Flatten: every run points straight at its root, roots sum the area
+//   3. Give each root big enough a slot, in order of its topmost run
+//   4. Fold every run into its component's statistics
+void Components_Label(ComponentList *list, const RowRunList *runs)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint16_t *parent = list->parent;
+    uint16_t *slot = list->slot;
+    uint16_t n = runs->num_runs;
+
+    list->count = 0;
+    list->dropped = 0;
+    list->overflow = false;
+
+    for (uint16_t i = 0; i < n; i++) parent[i] = i;
+
+    // 1.
+    for (uint16_t r = 1; r < runs->num_rows; r++) {
+        uint16_t i = runs->row_index[r - 1];
+        uint16_t i_end = runs->row_index[r];
+        uint16_t j = i_end;
+        uint16_t j_end = runs->row_index[r + 1];
+
+        while (i < i_end && j < j_end) {
+            const RowRun *a = &runs->runs[i];
+            const RowRun *b = &runs->runs[j];
+            uint32_t a_end = a->start + a->length;     // Exclusive
+            uint32_t b_end = b->start + b->length;
+
+            if (a->start <= b_end && b->start <= a_end) unite(parent, i, j);
+            if (a_end < b_end) i++;
+            else j++;
+        }
+    }
+
+    // 2. Roots come first, so one ascending pass leaves every parent a root
+    for (uint16_t i = 0; i < n; i++) {
+        parent[i] = parent[parent[i]];
+        slot[i] = 0;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t root = parent[i];
+        uint32_t area = slot[root] + runs->runs[i].length;
+        slot[root] = (area > 0xFFFFU) ? 0xFFFFU : (uint16_t)area;
+    }
+
+    // 3. and 4. A root is visited before the rest of its runs, so its slot
+    // is decided (overwriting its area) before anything reads it
+    uint32_t sum_x2[COMPONENTS_MAX];    // Sum of 2x + 1 over the pixels
+    uint32_t sum_y[COMPONENTS_MAX];
+    uint16_t last_y[COMPONENTS_MAX];
+
+    for (uint16_t r = 0; r < runs->num_rows; r++) {
+        uint16_t y = runs->first_row + r;
+
+        for (uint16_t i = runs->row_index[r]; i < runs->row_index[r + 1]; i++) {
+            if (parent[i] == i) {
+                if (slot[i] < COMPONENTS_MIN_AREA) {
+                    slot[i] = COMPONENT_NONE;
+                    list->dropped++;
+                } else if (list->count == COMPONENTS_MAX) {
+                    slot[i] = COMPONENT_NONE;
+                    list->overflow = true;
+                } else {
+                    Component *c = &list->items[list->count];
+                    memset(c, 0, sizeof(*c));
+                    c->x_min = IMAGE_WIDTH;
+                    c->y_min = y;
+                    sum_x2[list->count] = 0;
+                    sum_y[list->count] = 0;
+                    last_y[list->count] = COMPONENT_NONE;
+                    slot[i] = list->count++;
+                }
+            }
+
+            uint16_t k = slot[parent[i]];
+            if (k == COMPONENT_NONE) continue;
+
+            const RowRun *run = &runs->runs[i];
+            Component *c = &list->items[k];
+            c->area += run->length;
+            c->num_runs++;
+            if (run->start < c->x_min) c->x_min = run->start;
+            if (run->start + run->length - 1 > c->x_max) c->x_max = run->start + run->length - 1;
+            c->y_max = y;
+            if (last_y[k] != y) {
+                last_y[k] = y;
+                c->num_rows++;
+            }
+            // Sum of (2x + 1) over x in [s, s + len) is len * (2s + len)
+            sum_x2[k] += (uint32_t)run->length * (2U * run->start + run->length);
+            sum_y[k] += (uint32_t)run->length * y;
+        }
+    }
+
+    for (uint16_t k = 0; k < list->count; k++) {
+        Component *c = &list->items[k];
+        c->centroid_x_q8 = div_q8(sum_x2[k], 2U * c->area);
+        c->centroid_y_q8 = div_q8(sum_y[k], c->area) + 128U;
+    }
+
+    VisionTiming_Record(&vision_timing.components, start);
+}
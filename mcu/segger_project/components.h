@@ -0,0 +1,44 @@
+// components.h
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "row_runs.h"
+#include <stdbool.h>
+
+#define COMPONENT_NONE 0xFFFFU
+
+// One 8-connected blob of line pixels
+typedef struct {
+    uint32_t area;              // Pixels
+    uint16_t x_min, x_max;      // Bounding box, inclusive
+    uint16_t y_min, y_max;      // Also the component's row extent
+    uint32_t centroid_x_q8;     // 1/256 pixel, pixel centres at x + 0.5
+    uint32_t centroid_y_q8;
+    uint16_t num_runs;
+    uint16_t num_rows;          // Rows with at least one run
+} Component;
+
+// Components of one RowRunList, in order of their topmost run. Blobs smaller
+// than COMPONENTS_MIN_AREA are dropped as noise before they take a slot.
+typedef struct {
+    Component items[COMPONENTS_MAX];
+    uint16_t count;
+    uint16_t dropped;           // Noise blobs below the minimum area
+    bool overflow;              // More than COMPONENTS_MAX real blobs
+
+    // Per run: union-find parent, then the root's area, then its slot
+    uint16_t parent[ROW_RUNS_MAX];
+    uint16_t slot[ROW_RUNS_MAX];
+} ComponentList;
+
+void Components_Label(ComponentList *list, const RowRunList *runs);
+
+// Component index of run i of the list it was labelled from, or COMPONENT_NONE
+static inline uint16_t Components_RunLabel(const ComponentList *list, uint16_t i)
+{
+    return list->slot[list->parent[i]];
+}
+
+#endif // COMPONENTS_H
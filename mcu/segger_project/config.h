@@ -18,6 +18,17 @@
 #define FRAME_ACTIVE_PIN   GPIO_PIN_10  // PA10 Corresponds to FPGA's in_frame
 #define PIXEL_DATA_PIN     GPIO_PIN_6  // PA6, Corresponds to FPGA's cam_wr_data
 
+// Camera/FPGA pairs, one per side of the robot, each steering its own motor
+#define NUM_CAMERAS        2
+
+// SPI link to the FPGA frame buffers (SCK PB3, MISO PB4, MOSI PA7 shared).
+// Each FPGA has its own select and frame_ready, and floats MISO while its
+// select is high.
+#define SPI_CS_LEFT_PIN        GPIO_PIN_4   // PA4, left FPGA's mcu_cs_n
+#define SPI_CS_RIGHT_PIN       GPIO_PIN_1   // PA1, right FPGA's mcu_cs_n
+#define FRAME_READY_LEFT_PIN   FRAME_ACTIVE_PIN // PA10, left FPGA's mcu_frame_ready
+#define FRAME_READY_RIGHT_PIN  GPIO_PIN_12  // PA12, right FPGA's mcu_frame_ready
+
 // ============================================================================
 // Image Dimensions
 // ============================================================================
@@ -26,10 +37,159 @@
 #define IMAGE_HEIGHT       240
 #define IMAGE_SIZE_PIXELS  76800
 #define IMAGE_SIZE_BYTES   9600 // (320 * 240) / 8
+#define IMAGE_ROW_BYTES    40   // 320 / 8
+#define IMAGE_ROW_WORDS    10   // 320 / 32
+#define IMAGE_SIZE_WORDS   2400 // IMAGE_ROW_WORDS * IMAGE_HEIGHT
+
+// Canonical packed frame format, shared with fpga/src/frame_buffer_spram.sv:
+// pixel (x, y) is bit (x % 32) of little-endian uint32_t word
+// y * IMAGE_ROW_WORDS + x / 32. Rows are word aligned and pixel 0 of a word
+// is its LSB, so byte-wise it is bit (x % 8) of byte y * IMAGE_ROW_BYTES + x / 8.
+// The FPGA sends each 16-bit SPRAM word LSB first and the MCU receives 16-bit
+// LSB-first SPI frames, which lands every bit in this position with no fixups.
+
+// Parallel-pin fallback (see camera_capture.h): 1 reads one camera over
+// PCLK, DATA_VALID and PIXEL_DATA instead of the SPI link. PCLK is the left
+// motor's forward pin, so only the right motor is driven.
+#define CAPTURE_PARALLEL     0
+// Raw GPIOA->IDR samples buffered per PCLK edge
 #define DMA_RAW_BUFFER_SIZE  2048
 
+// Frame pool. Streaming, per camera: one armed or being captured, one ready
+// or being processed; only one transfer is on the shared bus at a time. The
+// parallel fallback reads one camera into one frame, plus the thinning scratch.
+#if CAPTURE_PARALLEL
+#define FRAME_POOL_SIZE    (1 + THIN_CENTRELINE)
+#else
+#define FRAME_POOL_SIZE    (2 * NUM_CAMERAS)
+#endif
+
+// RAM banks (STM32L432KCUx_MemoryMap.xml): RAM1 at 0x10000000, RAM2 at
+// 0x20000000, not contiguous. The frame pool is placed alone in RAM2; the
+// other statics, the stack and the heap get RAM1 and what the pool leaves.
+#define RAM1_BYTES         (16 * 1024)
+#define RAM2_BYTES         (48 * 1024)
+// Everything but the pool: ~22 kB of statics, 2 kB stack, 1 kB heap
+#define RAM_OTHER_BYTES    (25 * 1024)
+
+// Region of interest: row bands the FPGA sends per frame (see frame_pool.h)
+#define ROI_MAX_BANDS      4
+
+// The FPGA follows every band with an info word (frame sequence and age)
+// and a CRC-32 of the payload and info word
+#define FRAME_TRAILER_BYTES 8
+
+// Streaming capture: rows per partial-frame callback (must divide IMAGE_HEIGHT)
+#define STREAM_BAND_ROWS   16
+
+// Capture supervision (all non-blocking, timed off the DWT cycle counter)
+#define CAPTURE_WAIT_TIMEOUT_MS      100  // frame_ready must rise within this
+#define CAPTURE_TRANSFER_TIMEOUT_MS  25   // 76800 bits at 10 MHz SCK take ~8 ms
+#define CAPTURE_PARALLEL_TIMEOUT_MS  80   // Parallel pins run at camera rate, ~33 ms
+#define FRAME_STALE_TIMEOUT_MS       150  // Control fails safe after this long
+#define WATCHDOG_TIMEOUT_MS          250  // IWDG reload, main loop must refresh
+
+// SPI link-rate calibration against the FPGA test pattern
+#define CALIBRATION_ROWS        24    // Pattern rows per test transfer
+#define CALIBRATION_REPEATS     4     // Clean transfers needed to accept a rate
+#define CALIBRATION_TIMEOUT_MS  5     // Per test transfer, 24 rows at 5 MHz take ~2 ms
+#define LINK_MARGIN_STEPS       1     // Rates backed off from the first failing one
+#define LINK_ERROR_THRESHOLD    8     // Link errors within the window that trigger a recalibration
+#define LINK_ERROR_WINDOW_MS    1000
+
+// Latency histograms (see latency_stats.h)
+#define LATENCY_BINS            128
+#define LATENCY_BIN_US          500   // 128 bins cover 64 ms
+#define LATENCY_REPORT_MS       1000  // RTT report period
+
+// Column projection line estimate (see line_projection.h)
+#define PROJECTION_PLANES       8     // Bit-sliced counter depth, counts up to 255 rows
+#define PROJECTION_BAND_ROWS    16    // Rows per band count
+#define PROJECTION_BANDS        (IMAGE_HEIGHT / PROJECTION_BAND_ROWS)
+#define PROJECTION_MIN_PIXELS   200   // Fewer line pixels than this is "no line"
+
+// Row run lists (see row_runs.h): 4 bytes per run, a clean line needs 240
+#define ROW_RUNS_MAX            1024
+
+// Speckle filter run on the streamed rows before any other stage (see
+// morphology.h). Each ROI band is filtered as a whole, across chunk edges.
+#define MORPH_FILTER            MORPH_OPEN
+#define MORPH_FILTER_SHAPE      MORPH_CROSS
+
+// Connected components (see components.h)
+#define COMPONENTS_MAX          32
+#define COMPONENTS_MIN_AREA     24    // Smaller blobs are noise and take no slot
+
+// Least-squares line heading (see line_heading.h)
+#define HEADING_ROW_STEP        2     // Fit every Nth row; raise it when the frame budget is tight
+#define HEADING_WEIGHTED        1     // 1: near rows weigh up to 8x the far ones
+#define HEADING_NEAR_ROW        (IMAGE_HEIGHT - 1)  // Row closest to the robot
+#define HEADING_WEIGHT_ROWS     32    // Weight steps by 1 every this many rows
+#define HEADING_ROW_RUNS        16    // More runs in a row than this is noise
+#define HEADING_MIN_RUN         3     // Line run width limits, pixels
+#define HEADING_MAX_RUN         80
+#define HEADING_GATE            24    // Max centre jump between sampled rows, pixels
+#define HEADING_MIN_POINTS      8
+
+// Alpha-beta line tracker (see line_tracker.h)
+#define TRACKER_ALPHA_Q8        128   // Position gain 0.5
+#define TRACKER_BETA_Q8         32    // Rate gain 0.125
+#define TRACKER_WINDOW_MIN      16    // Search half-width at full confidence, pixels
+#define TRACKER_WINDOW_MAX      48    // ... and at zero confidence
+#define TRACKER_MAX_MISSES      3     // Frames without the line before searching whole rows
+#define TRACKER_MAX_GAP         8     // Frames between updates before the rates are stale
+
+// Sparse lookahead rows (see scan_lines.h), nearest first
+#define SCAN_LINES_MAX          8
+#define SCAN_LINE_ROWS          { 236, 220, 200, 176, 148, 116, 80, 40 }
+#define SCAN_LINES_MIN_FOUND    2     // Rows that must see the line for an estimate
+// 1: switch each camera between full and sparse analysis on its own
+#define VISION_MODE_AUTO        1
+#define SCAN_LINES_ENTER_Q8     200   // Full-frame confidence needed to go sparse
+#define SCAN_LINES_ENTER_HEADING_Q15 3277  // ... and |heading| at most 0.1 rad
+#define SCAN_LINES_EXIT_Q8      192   // Sparse confidence below this goes back to full
+
+// Coarse levels (see pyramid.h)
+#define PYRAMID_HALF_ROWS       60    // 160-wide rows kept, nearest first; 20 bytes each
+#define PYRAMID_MAJORITY        0     // 0: OR keeps thin lines, 1: 2-of-4 drops speckle
+#define PYRAMID_MIN_HEIGHT      8     // 80x60 column count that counts as a line
+#define PYRAMID_MARGIN          8     // Slack added to the search half-width, pixels
+
+// Floor coordinates (see ground.h; tables from mcu/ground_lut.py)
+#define GROUND_FAR_ROW          120   // Far end of the fitted line taken onto the floor
+
+// Track shape classifier (see track_shape.h)
+#define SHAPE_GATE              24    // Max line jump between rows, pixels, plus 1 per empty row
+#define SHAPE_WIDTH_ROWS        8     // Nearest line rows averaged for the line width
+#define SHAPE_BAR_MIN           48    // Shortest run that is a bar across the line, pixels
+#define SHAPE_BAR_FACTOR        3     // ... and at least this many line widths
+#define SHAPE_ARM_MIN           20    // Bar reach past the line centre that makes a branch, pixels
+#define SHAPE_CONTINUE_ROWS     12    // Line this many rows past a bar goes on through it
+#define SHAPE_GAP_ROWS          8     // Empty rows between two line pieces that make a gap
+#define SHAPE_END_ROWS          24    // Empty rows past the line's far end that make an end
+#define SHAPE_GAP_SCAN_ROWS     2     // The same two, in lookahead rows missed, for sparse
+#define SHAPE_END_SCAN_ROWS     2     // frames (rows 16-40 apart, see SCAN_LINE_ROWS)
+#define SHAPE_EDGE              16    // A line ending this close to a side left the frame, pixels
+#define SHAPE_CURVE             10    // Far-zone bend that makes a curve, pixels
+#define SHAPE_MIN_ROWS          2     // Rows with the line for any shape but TRACK_NONE
+#define SHAPE_ACT_Q8            160   // Confidence the controller acts on a shape at
+
+// Centreline thinning (see thinning.h). 1: thin each full frame's filtered
+// runs once its motor pin is written, in a spare pool frame. Off while no
+// stage reads frame_centreline: a wide line costs up to THIN_MAX_ITERATIONS
+// passes per band.
+#define THIN_CENTRELINE         0
+#define THIN_MAX_ITERATIONS     24    // Each peels a pixel off both sides: lines up to ~48 px wide
+#define THIN_MAX_POINTS         160   // Centreline points kept, 4 bytes each
+#define THIN_POINT_ROW_STEP     2     // Points on every Nth row
+
+// 1: time the vision kernels against the per-bit code they replaced and
+// print the cycle counts on RTT every VISION_BENCHMARK_FRAMES frames
+#define VISION_BENCHMARK        0
+#define VISION_BENCHMARK_FRAMES 64
+
 // Thresholds
-#define THRESHOLD_BLACK = 47000;
-#define THRESHOLD_WHITE = 47000;
+#define THRESHOLD_BLACK    47000
+#define THRESHOLD_WHITE    47000
 
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+// frame_pool.c
+#include "frame_pool.h"
+
+#define FRAME_BYTES (IMAGE_SIZE_BYTES + FRAME_TRAILER_BYTES)
+
+#if FRAME_POOL_SIZE * FRAME_BYTES > RAM2_BYTES
+#error "FRAME_POOL_SIZE frames do not fit RAM2"
+#endif
+#if FRAME_POOL_SIZE * FRAME_BYTES + RAM_OTHER_BYTES > RAM1_BYTES + RAM2_BYTES
+#error "FRAME_POOL_SIZE frames leave less than RAM_OTHER_BYTES for the rest"
+#endif
+
+// FRAME_TRAILER_BYTES of slack: a band's trailer lands just past its last row.
+// The pool alone fills most of RAM2, so it is placed there explicitly rather
+// than left to the linker to split across the banks. It is never zeroed at
+// startup (see FramePool_Acquire()).
+static uint8_t frame_storage[FRAME_POOL_SIZE][FRAME_BYTES] __attribute__((aligned(4), section(".RAM2.non_init")));
+static FrameDescriptor frames[FRAME_POOL_SIZE];
+
+// All pool calls come from the foreground loop; the DMA ISR only writes into
+// a descriptor it was handed, it never acquires or releases one.
+
+void FramePool_Init(void)
+{
+    for (uint8_t i = 0; i < FRAME_POOL_SIZE; i++) {
+        frames[i].data = frame_storage[i];
+        frames[i].valid_bytes = 0;
+        frames[i].sequence = 0;
+        frames[i].exposed_at = 0;
+        frames[i].started_at = 0;
+        frames[i].timestamp = 0;
+        frames[i].ref_count = 0;
+        frames[i].index = i;
+    }
+}
+
+// Hands out a free frame with one reference, or NULL if all are in use.
+// The contents are left as they are; the capture path overwrites every byte
+// it reports in valid_bytes, so there is no need to clear 9.6 kB per frame.
+FrameDescriptor *FramePool_Acquire(void)
+{
+    for (uint8_t i = 0; i < FRAME_POOL_SIZE; i++) {
+        if (frames[i].ref_count == 0) {
+            frames[i].ref_count = 1;
+            frames[i].valid_bytes = 0;
+            // Whole frame unless the capture path asks for less
+            frames[i].bands[0].first_row = 0;
+            frames[i].bands[0].num_rows = IMAGE_HEIGHT;
+            frames[i].num_bands = 1;
+            frames[i].source = CAMERA_LEFT;
+            return &frames[i];
+        }
+    }
+    return NULL;
+}
+
+// Lets a second consumer (e.g. telemetry) keep a frame without copying it
+void FramePool_Retain(FrameDescriptor *frame)
+{
+    if (frame != NULL) {
+        frame->ref_count++;
+    }
+}
+
+void FramePool_Release(FrameDescriptor *frame)
+{
+    if (frame != NULL && frame->ref_count > 0) {
+        frame->ref_count--;
+    }
+}
+
+uint8_t FramePool_FreeCount(void)
+{
+    uint8_t free_frames = 0;
+    for (uint8_t i = 0; i < FRAME_POOL_SIZE; i++) {
+        if (frames[i].ref_count == 0) free_frames++;
+    }
+    return free_frames;
+}
@@ -0,0 +1,54 @@
+// frame_pool.h
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include <stdbool.h>
+
+// A run of full rows requested from the FPGA. Rows outside a frame's bands
+// are not transferred and hold stale data.
+typedef struct {
+    uint8_t first_row;
+    uint8_t num_rows;
+} FrameBand;
+
+// Which camera/FPGA pair a frame came from (see NUM_CAMERAS)
+typedef enum {
+    CAMERA_LEFT = 0,
+    CAMERA_RIGHT = 1
+} FrameSource;
+
+// One binary frame plus the metadata that travels with it. Ownership is
+// reference counted: whoever acquires or retains a frame must release it.
+typedef struct {
+    uint8_t *data;              // IMAGE_SIZE_BYTES, 4-byte aligned
+    uint32_t valid_bytes;       // Bytes actually written by the capture path
+    uint32_t sequence;          // FPGA frame number, gaps mean dropped frames
+    uint32_t exposed_at;        // DWT->CYCCNT when the FPGA finished storing it
+    uint32_t started_at;        // DWT->CYCCNT when its transfer started
+    uint32_t timestamp;         // DWT->CYCCNT when the capture completed
+    FrameBand bands[ROI_MAX_BANDS]; // Rows that were read, in arrival order
+    uint8_t  num_bands;
+    uint8_t  source;            // FrameSource that filled it
+    uint8_t  ref_count;         // 0 = free
+    uint8_t  index;             // Slot in the pool
+} FrameDescriptor;
+
+// Whether a frame's bands transferred the row
+static inline bool FramePool_HasRow(const FrameDescriptor *frame, uint16_t row)
+{
+    for (uint8_t b = 0; b < frame->num_bands; b++) {
+        const FrameBand *band = &frame->bands[b];
+        if (row >= band->first_row && row < band->first_row + band->num_rows) return true;
+    }
+    return false;
+}
+
+void FramePool_Init(void);
+FrameDescriptor *FramePool_Acquire(void);
+void FramePool_Retain(FrameDescriptor *frame);
+void FramePool_Release(FrameDescriptor *frame);
+uint8_t FramePool_FreeCount(void);
+
+#endif // FRAME_POOL_H
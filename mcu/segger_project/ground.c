@@ -0,0 +1,26 @@
+// ground.c
+#include "ground.h"
+#include "line_heading.h"
+#include <string.h>
+
+// Offset at the near point and the angle of near -> far on the floor. The
+// ratio goes through the same integer arctangent as the image heading, so
+// this costs one divide.
+bool Ground_Line(const GroundPoint *near, const GroundPoint *far, GroundLine *line)
+{
+    memset(line, 0, sizeof(*line));
+
+    int32_t dy = far->y_mm_q8 - near->y_mm_q8;
+    if (dy <= 0) return false;
+
+    int64_t z_q16 = ((int64_t)(far->x_mm_q8 - near->x_mm_q8) * 65536) / dy;
+    if (z_q16 > INT32_MAX) z_q16 = INT32_MAX;
+    if (z_q16 < -INT32_MAX) z_q16 = -INT32_MAX;
+
+    line->near = *near;
+    line->far = *far;
+    line->offset_mm_q8 = near->x_mm_q8;
+    line->heading_q15 = LineHeading_Atan_q15((int32_t)z_q16);
+    line->found = true;
+    return true;
+}
@@ -0,0 +1,64 @@
+// ground.h
+#ifndef GROUND_H
+#define GROUND_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include <stdbool.h>
+
+// Inverse perspective: where on the floor a pixel is. The camera has no
+// roll, so the floor distance depends on the row only and the floor width of
+// a pixel is the same all along a row: two tables of IMAGE_HEIGHT entries,
+// in flash, generated by mcu/ground_lut.py from the camera height, pitch and
+// intrinsics. Mapping a point is one multiply, no trig.
+//
+// Floor coordinates are relative to the point on the floor below the camera:
+// x to the right, y straight ahead, 1/256 mm.
+typedef struct {
+    int32_t centre_x_q8;                        // Principal point column, 1/256 pixel
+    uint16_t forward_q4[IMAGE_HEIGHT];          // Floor distance ahead, 1/16 mm; 0 = row doesn't see the floor in range
+    uint16_t mm_per_px_q12[IMAGE_HEIGHT];       // Floor width of one pixel, 1/4096 mm
+} GroundLut;
+
+extern const GroundLut ground_lut;              // ground_lut.c
+
+typedef struct {
+    int32_t x_mm_q8;
+    int32_t y_mm_q8;
+} GroundPoint;
+
+// A line on the floor through two points on it
+typedef struct {
+    GroundPoint near;
+    GroundPoint far;
+    int32_t offset_mm_q8;       // Right of the camera at the near point
+    int32_t heading_q15;        // Angle from straight ahead on the floor, radians Q15, + = right
+    bool found;
+} GroundLine;
+
+static inline bool Ground_RowValid(uint16_t row)
+{
+    return row < IMAGE_HEIGHT && ground_lut.forward_q4[row] != 0;
+}
+
+// Floor point of a row and a column offset from the image centre (the
+// LineEstimate convention). False if the row doesn't see the floor.
+static inline bool Ground_Point(uint16_t row, int32_t offset_q8, GroundPoint *p)
+{
+    if (!Ground_RowValid(row)) return false;
+
+    int32_t x_q8 = offset_q8 + (IMAGE_WIDTH / 2) * 256 - ground_lut.centre_x_q8;
+    p->x_mm_q8 = (int32_t)(((int64_t)x_q8 * ground_lut.mm_per_px_q12[row]) >> 12);
+    p->y_mm_q8 = (int32_t)ground_lut.forward_q4[row] << 4;
+    return true;
+}
+
+// Floor distance ahead of a row in whole mm, 0 if it doesn't see the floor
+static inline uint16_t Ground_Distance_mm(uint16_t row)
+{
+    return (row < IMAGE_HEIGHT) ? ground_lut.forward_q4[row] >> 4 : 0;
+}
+
+bool Ground_Line(const GroundPoint *near, const GroundPoint *far, GroundLine *line);
+
+#endif // GROUND_H
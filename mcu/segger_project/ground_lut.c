@@ -0,0 +1,55 @@
+// ground_lut.c
+// Generated by mcu/ground_lut.py, do not edit: rerun it after changing the
+// camera mount.
+// Camera: 120 mm above the floor, pitched 40 deg down, fx 290,
+// fy 290, principal point (160, 120), range 4000 mm.
+// Rows 0 to 239 see the floor.
+#include "ground.h"
+
+const GroundLut ground_lut = {
+    .centre_x_q8 = 40960,
+    .forward_q4 = {
+         6051,  5989,  5929,  5870,  5811,  5753,  5697,  5641,  5586,  5532,  5478,  5426,
+         5374,  5323,  5273,  5223,  5174,  5126,  5078,  5032,  4985,  4940,  4895,  4851,
+         4807,  4764,  4721,  4679,  4638,  4597,  4557,  4517,  4478,  4439,  4400,  4363,
+         4325,  4288,  4252,  4216,  4180,  4145,  4110,  4076,  4042,  4009,  3976,  3943,
+         3911,  3879,  3847,  3816,  3785,  3754,  3724,  3694,  3665,  3636,  3607,  3578,
+         3550,  3522,  3495,  3467,  3440,  3414,  3387,  3361,  3335,  3309,  3284,  3259,
+         3234,  3209,  3185,  3161,  3137,  3113,  3090,  3067,  3044,  3021,  2999,  2976,
+         2954,  2932,  2911,  2889,  2868,  2847,  2826,  2805,  2785,  2765,  2745,  2725,
+         2705,  2685,  2666,  2647,  2628,  2609,  2590,  2572,  2553,  2535,  2517,  2499,
+         2482,  2464,  2447,  2429,  2412,  2395,  2378,  2362,  2345,  2329,  2312,  2296,
+         2280,  2264,  2249,  2233,  2217,  2202,  2187,  2172,  2157,  2142,  2127,  2112,
+         2098,  2083,  2069,  2055,  2041,  2027,  2013,  1999,  1985,  1972,  1958,  1945,
+         1931,  1918,  1905,  1892,  1879,  1867,  1854,  1841,  1829,  1816,  1804,  1792,
+         1780,  1768,  1756,  1744,  1732,  1720,  1708,  1697,  1685,  1674,  1663,  1651,
+         1640,  1629,  1618,  1607,  1596,  1585,  1575,  1564,  1553,  1543,  1532,  1522,
+         1512,  1502,  1491,  1481,  1471,  1461,  1451,  1441,  1432,  1422,  1412,  1403,
+         1393,  1384,  1374,  1365,  1356,  1346,  1337,  1328,  1319,  1310,  1301,  1292,
+         1283,  1274,  1266,  1257,  1248,  1240,  1231,  1223,  1214,  1206,  1197,  1189,
+         1181,  1173,  1165,  1157,  1148,  1140,  1133,  1125,  1117,  1109,  1101,  1093,
+         1086,  1078,  1070,  1063,  1055,  1048,  1041,  1033,  1026,  1018,  1011,  1004,
+    },
+    .mm_per_px_q12 = {
+         5181,  5140,  5099,  5059,  5019,  4980,  4942,  4904,  4867,  4830,  4794,  4759,
+         4723,  4689,  4655,  4621,  4588,  4556,  4524,  4492,  4461,  4430,  4400,  4370,
+         4340,  4311,  4282,  4254,  4226,  4198,  4171,  4144,  4117,  4091,  4065,  4040,
+         4014,  3989,  3965,  3940,  3916,  3892,  3869,  3846,  3823,  3800,  3778,  3756,
+         3734,  3712,  3691,  3670,  3649,  3628,  3608,  3588,  3568,  3548,  3529,  3509,
+         3490,  3471,  3453,  3434,  3416,  3398,  3380,  3362,  3345,  3327,  3310,  3293,
+         3276,  3260,  3243,  3227,  3211,  3195,  3179,  3163,  3148,  3132,  3117,  3102,
+         3087,  3072,  3058,  3043,  3029,  3015,  3001,  2987,  2973,  2959,  2945,  2932,
+         2919,  2905,  2892,  2879,  2866,  2854,  2841,  2829,  2816,  2804,  2792,  2780,
+         2768,  2756,  2744,  2732,  2721,  2709,  2698,  2686,  2675,  2664,  2653,  2642,
+         2631,  2621,  2610,  2599,  2589,  2579,  2568,  2558,  2548,  2538,  2528,  2518,
+         2508,  2498,  2489,  2479,  2469,  2460,  2450,  2441,  2432,  2423,  2414,  2405,
+         2396,  2387,  2378,  2369,  2360,  2352,  2343,  2335,  2326,  2318,  2309,  2301,
+         2293,  2285,  2277,  2269,  2261,  2253,  2245,  2237,  2229,  2221,  2214,  2206,
+         2199,  2191,  2184,  2176,  2169,  2162,  2154,  2147,  2140,  2133,  2126,  2119,
+         2112,  2105,  2098,  2091,  2084,  2078,  2071,  2064,  2058,  2051,  2044,  2038,
+         2032,  2025,  2019,  2012,  2006,  2000,  1994,  1987,  1981,  1975,  1969,  1963,
+         1957,  1951,  1945,  1939,  1934,  1928,  1922,  1916,  1911,  1905,  1899,  1894,
+         1888,  1883,  1877,  1872,  1866,  1861,  1855,  1850,  1845,  1839,  1834,  1829,
+         1824,  1818,  1813,  1808,  1803,  1798,  1793,  1788,  1783,  1778,  1773,  1768,
+    },
+};
@@ -0,0 +1,141 @@
+// latency_stats.c
+#include "latency_stats.h"
+#include "SEGGER_RTT.h"
+#include <stdio.h>
+#include <string.h>
+
+LatencyStats latency_stats[NUM_CAMERAS];
+
+// Reports get their own RTT channel in skip mode, so a slow or absent host
+// never stalls the control loop (image_to_file() makes channel 0 blocking)
+#define LATENCY_RTT_CHANNEL 1
+static char rtt_buffer[512];
+
+static uint32_t cycles_per_us;
+
+// ============================================================================
+// Internal Helpers
+// ============================================================================
+
+static void histogram_reset(LatencyHistogram *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min_us = UINT32_MAX;
+}
+
+static void histogram_add(LatencyHistogram *h, uint32_t us)
+{
+    uint32_t bin = us / LATENCY_BIN_US;
+    if (bin >= LATENCY_BINS) bin = LATENCY_BINS - 1;
+
+    // Halve every bin rather than let one wrap; the percentile only needs
+    // the shape, and it keeps favouring recent samples
+    if (h->bins[bin] == UINT16_MAX) {
+        for (uint32_t i = 0; i < LATENCY_BINS; i++) h->bins[i] >>= 1;
+    }
+    h->bins[bin]++;
+
+    h->count++;
+    h->sum_us += us;
+    if (us < h->min_us) h->min_us = us;
+    if (us > h->max_us) h->max_us = us;
+    h->mean_us = (uint32_t)(h->sum_us / h->count);
+
+    // Walk the tail from the top until it holds more than 1% of the samples
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < LATENCY_BINS; i++) total += h->bins[i];
+
+    uint32_t tail = 0;
+    uint32_t i = LATENCY_BINS;
+    while (i > 0) {
+        tail += h->bins[--i];
+        if (tail * 100U > total) break;
+    }
+    h->p99_us = (i + 1) * LATENCY_BIN_US;
+}
+
+static uint32_t elapsed_us(uint32_t from, uint32_t to)
+{
+    return (to - from) / cycles_per_us;
+}
+
+static int format_stage(char *line, size_t size, char side, const char *name, const LatencyHistogram *h)
+{
+    return snprintf(line, size, "%c %-8s n %lu  min %lu  mean %lu  max %lu  p99 %lu us\n",
+                    side, name, (unsigned long)h->count,
+                    (unsigned long)(h->count ? h->min_us : 0), (unsigned long)h->mean_us,
+                    (unsigned long)h->max_us, (unsigned long)h->p99_us);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void LatencyStats_Init(void)
+{
+    cycles_per_us = SystemCoreClock / 1000000U;
+
+    for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+        LatencyStats *st = &latency_stats[s];
+        histogram_reset(&st->queue);
+        histogram_reset(&st->transfer);
+        histogram_reset(&st->process);
+        histogram_reset(&st->total);
+        st->frames_acted = 0;
+        st->frames_lost = 0;
+        st->drop_permille = 0;
+        st->last_sequence = 0;
+    }
+
+    SEGGER_RTT_ConfigUpBuffer(LATENCY_RTT_CHANNEL, "Latency", rtt_buffer, sizeof(rtt_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+}
+
+// Call once a frame's motor command has been written. Frames that are
+// dropped anywhere on the way (never read from the FPGA, rejected on a CRC,
+// replaced before the control loop took them) show up as sequence gaps.
+void LatencyStats_Record(const FrameDescriptor *frame, uint32_t actuated_at)
+{
+    LatencyStats *st = &latency_stats[frame->source];
+
+    if (st->frames_acted > 0) {
+        uint32_t gap = frame->sequence - st->last_sequence;
+        if (gap > 1) st->frames_lost += gap - 1;
+    }
+    st->last_sequence = frame->sequence;
+    st->frames_acted++;
+    st->drop_permille = (uint32_t)((uint64_t)st->frames_lost * 1000U
+                                   / (st->frames_lost + st->frames_acted));
+
+    histogram_add(&st->queue, elapsed_us(frame->exposed_at, frame->started_at));
+    histogram_add(&st->transfer, elapsed_us(frame->started_at, frame->timestamp));
+    histogram_add(&st->process, elapsed_us(frame->timestamp, actuated_at));
+    histogram_add(&st->total, elapsed_us(frame->exposed_at, actuated_at));
+}
+
+// One block per camera on RTT channel LATENCY_RTT_CHANNEL. Lines that don't
+// fit in the buffer are skipped, never waited for.
+void LatencyStats_Report(void)
+{
+    static const char sides[NUM_CAMERAS] = { 'L', 'R' };
+    char line[128];
+    int len;
+
+    for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+        const LatencyStats *st = &latency_stats[s];
+
+        len = format_stage(line, sizeof(line), sides[s], "queue", &st->queue);
+        SEGGER_RTT_Write(LATENCY_RTT_CHANNEL, line, len);
+        len = format_stage(line, sizeof(line), sides[s], "transfer", &st->transfer);
+        SEGGER_RTT_Write(LATENCY_RTT_CHANNEL, line, len);
+        len = format_stage(line, sizeof(line), sides[s], "process", &st->process);
+        SEGGER_RTT_Write(LATENCY_RTT_CHANNEL, line, len);
+        len = format_stage(line, sizeof(line), sides[s], "total", &st->total);
+        SEGGER_RTT_Write(LATENCY_RTT_CHANNEL, line, len);
+
+        len = snprintf(line, sizeof(line), "%c frames %lu  lost %lu  drop %lu/1000\n", sides[s],
+                       (unsigned long)st->frames_acted, (unsigned long)st->frames_lost,
+                       (unsigned long)st->drop_permille);
+        SEGGER_RTT_Write(LATENCY_RTT_CHANNEL, line, len);
+    }
+}
@@ -0,0 +1,40 @@
+// latency_stats.h
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+
+// Running statistics for one pipeline stage, in microseconds. The summary
+// fields are kept up to date on every sample, so a debugger's live watch (or
+// LatencyStats_Report() over RTT) can read them while the robot runs.
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t mean_us;
+    uint32_t p99_us;                    // Upper edge of the bin holding the 99th percentile
+    uint64_t sum_us;
+    uint16_t bins[LATENCY_BINS];        // LATENCY_BIN_US each, last one is open ended
+} LatencyHistogram;
+
+// Per camera, from the FPGA bank swap to the motor pins
+typedef struct {
+    LatencyHistogram queue;             // Bank swap -> transfer start
+    LatencyHistogram transfer;          // Transfer start -> last band landed
+    LatencyHistogram process;           // Last band landed -> motor command written
+    LatencyHistogram total;             // Bank swap -> motor command written
+    uint32_t frames_acted;              // Frames that reached the motors
+    uint32_t frames_lost;               // Camera frames that never did (sequence gaps)
+    uint32_t drop_permille;             // frames_lost per 1000 camera frames
+    uint32_t last_sequence;
+} LatencyStats;
+
+extern LatencyStats latency_stats[NUM_CAMERAS];
+
+void LatencyStats_Init(void);
+void LatencyStats_Record(const FrameDescriptor *frame, uint32_t actuated_at);
+void LatencyStats_Report(void);
+
+#endif // LATENCY_STATS_H
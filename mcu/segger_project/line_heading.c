@@ -0,0 +1,197 @@
+// line_heading.c
+#include "line_heading.h"
+#include "row_runs.h"
+#include "vision_timing.h"
+#include <string.h>
+
+#define PI_2_Q15    51472       // pi / 2
+#define PI_4_Q15    25736       // pi / 4
+#define ATAN_K_Q15  8946        // 0.273, see LineHeading_Atan_q15()
+
+// ============================================================================
+// Accumulation
+// ============================================================================
+
+// seed_q8 is where the line is expected on the first row, as an offset from
+// the image centre (the tracker's prediction or last frame's offset).
+// window limits each row's scan to that many pixels either side of the
+// line's centre on the previous sampled row; 0 scans whole rows.
+void LineHeading_Clear(HeadingFit *fit, bool weighted, uint8_t row_step, int32_t seed_q8, uint16_t window)
+{
+    memset(fit, 0, sizeof(*fit));
+    for (uint16_t y = 0; y < IMAGE_HEIGHT; y++) fit->centre_q1[y] = HEADING_NO_CENTRE;
+
+    int32_t seed_q1 = (seed_q8 >> 7) + IMAGE_WIDTH;
+    if (seed_q1 < 0) seed_q1 = 0;
+    if (seed_q1 > 2 * IMAGE_WIDTH) seed_q1 = 2 * IMAGE_WIDTH;
+    fit->track_q1 = (int16_t)seed_q1;
+    fit->weighted = weighted;
+    fit->row_step = row_step ? row_step : 1;
+    fit->window = window;
+}
+
+// 1 on the far row up to 1 + (IMAGE_HEIGHT - 1) / HEADING_WEIGHT_ROWS on the
+// near one
+static uint32_t row_weight(const HeadingFit *fit, uint16_t y)
+{
+    if (!fit->weighted) return 1;
+    uint16_t dist = (y > HEADING_NEAR_ROW) ? y - HEADING_NEAR_ROW : HEADING_NEAR_ROW - y;
+    return 1 + (IMAGE_HEIGHT - 1 - dist) / HEADING_WEIGHT_ROWS;
+}
+
+// Picks the run whose centre is nearest the previous row's, so the fit
+// follows one line even with a crossing or a second line in view. Runs too
+// short (noise) or too wide (crossings) are skipped, and once a line is
+// being tracked a jump of more than HEADING_GATE pixels is rejected.
+static int32_t row_centre(const HeadingFit *fit, const BitImage *rows, uint16_t r)
+{
+    RowRun runs[HEADING_ROW_RUNS];
+    uint16_t n;
+    if (fit->window) {
+        int32_t x = fit->track_q1 / 2;
+        uint16_t x0 = (x > fit->window) ? (uint16_t)(x - fit->window) : 0;
+        n = RowRuns_ExtractSpan(rows, r, x0, (uint16_t)(x + fit->window + 1), runs, HEADING_ROW_RUNS);
+    } else {
+        n = RowRuns_ExtractRow(rows, r, runs, HEADING_ROW_RUNS);
+    }
+    if (n > HEADING_ROW_RUNS) return HEADING_NO_CENTRE;     // Noise, not a line
+
+    int32_t best = HEADING_NO_CENTRE;
+    int32_t best_dist = fit->tracking ? 2 * HEADING_GATE + 1 : INT32_MAX;
+    for (uint16_t i = 0; i < n; i++) {
+        if (runs[i].length < HEADING_MIN_RUN || runs[i].length > HEADING_MAX_RUN) continue;
+
+        int32_t centre_q1 = 2 * runs[i].start + runs[i].length;
+        int32_t dist = centre_q1 - fit->track_q1;
+        if (dist < 0) dist = -dist;
+        if (dist < best_dist) {
+            best_dist = dist;
+            best = centre_q1;
+        }
+    }
+    return best;
+}
+
+// Adds the sampled rows of a full-width view, placed in the frame by its y:
+// one RowRuns scan per row and six multiply-accumulates per centre.
+void LineHeading_AddRows(HeadingFit *fit, const BitImage *rows)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint16_t y = rows->y;
+    uint16_t end = rows->y + rows->height;
+
+    if (y % fit->row_step) y += fit->row_step - y % fit->row_step;
+    for (; y < end && y < IMAGE_HEIGHT; y += fit->row_step) {
+        int32_t x = row_centre(fit, rows, y - rows->y);
+        if (x == HEADING_NO_CENTRE) continue;
+
+        int64_t w = row_weight(fit, y);
+        fit->s_w += w;
+        fit->s_y += w * y;
+        fit->s_x += w * x;
+        fit->s_yy += w * y * y;
+        fit->s_xy += w * x * y;
+        fit->centre_q1[y] = (int16_t)x;
+        fit->track_q1 = (int16_t)x;
+        fit->tracking = true;
+        fit->points++;
+    }
+    fit->cycles += DWT->CYCCNT - start;
+}
+
+// ============================================================================
+// Fit
+// ============================================================================
+
+// atan(z) ~= z * (pi/4 + 0.273 * (1 - |z|)) for |z| <= 1, max error about
+// 0.004 rad. Beyond that atan(z) = +-pi/2 - atan(1/z).
+int32_t LineHeading_Atan_q15(int32_t z_q16)
+{
+    int64_t z = z_q16;
+    int64_t mag = (z < 0) ? -z : z;
+
+    if (mag > 65536) {
+        int32_t inv = (int32_t)(((int64_t)1 << 32) / z);
+        return (z < 0 ? -PI_2_Q15 : PI_2_Q15) - LineHeading_Atan_q15(inv);
+    }
+    return (int32_t)((z * PI_4_Q15 + ((z * ATAN_K_Q15 * (65536 - mag)) >> 16)) >> 16);
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+// Solves the normal equations from the sums, then makes one pass over the
+// stored centres for the residual. With W = sum of weights:
+//   b = (W * Sxy - Sx * Sy) / (W * Syy - Sy^2),   a = (Sx - b * Sy) / W
+// Centres are in half pixels, hence the extra factor 2 in every divide.
+void LineHeading_Estimate(HeadingFit *fit, LineHeading *out)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    memset(out, 0, sizeof(*out));
+    out->points = fit->points;
+
+    int64_t d_yy = fit->s_w * fit->s_yy - fit->s_y * fit->s_y;
+    if (fit->points >= HEADING_MIN_POINTS && d_yy > 0) {
+        int64_t d_xy = fit->s_w * fit->s_xy - fit->s_x * fit->s_y;
+        int64_t slope_q16 = (d_xy * 65536) / (2 * d_yy);
+
+        // a + b * y_near, in Q16 pixels
+        int64_t near_q16 = ((fit->s_x * 65536) / 2 + slope_q16 * (fit->s_w * HEADING_NEAR_ROW - fit->s_y)) / fit->s_w;
+
+        // Residuals in Q8 keep w * r^2 well inside 64 bits
+        uint64_t sum_r2 = 0;
+        for (uint16_t y = 0; y < IMAGE_HEIGHT; y++) {
+            if (fit->centre_q1[y] == HEADING_NO_CENTRE) continue;
+            int64_t fitted_q16 = near_q16 + slope_q16 * ((int32_t)y - HEADING_NEAR_ROW);
+            int64_t r_q8 = ((int64_t)fit->centre_q1[y] * 32768 - fitted_q16) >> 8;
+            sum_r2 += (uint64_t)(row_weight(fit, y) * r_q8 * r_q8);
+        }
+
+        out->slope_q16 = (int32_t)slope_q16;
+        // The far rows are above, so leaning right going up is dx / dy < 0
+        out->heading_q15 = LineHeading_Atan_q15((int32_t)-slope_q16);
+        out->offset_q8 = (int32_t)(near_q16 >> 8) - (IMAGE_WIDTH / 2) * 256;
+        uint64_t mean_q16 = sum_r2 / (uint64_t)fit->s_w;
+        out->residual_q16 = (mean_q16 >> 48) ? UINT32_MAX : isqrt64(mean_q16 << 16);
+        out->found = true;
+    }
+
+    fit->cycles += DWT->CYCCNT - start;
+    VisionTiming_RecordCycles(&vision_timing.heading, fit->cycles);
+}
+
+// The fitted line on the floor, from the near row to GROUND_FAR_ROW (or the
+// first row below it that sees the floor). Lines that look straight in the
+// image are straight on the floor, so two points carry it all.
+bool LineHeading_Ground(const LineHeading *heading, GroundLine *line)
+{
+    GroundPoint near, far;
+    uint16_t far_row = GROUND_FAR_ROW;
+
+    memset(line, 0, sizeof(*line));
+    if (!heading->found) return false;
+    while (far_row < HEADING_NEAR_ROW && !Ground_RowValid(far_row)) far_row++;
+    if (far_row >= HEADING_NEAR_ROW) return false;
+
+    int32_t far_offset_q8 = heading->offset_q8
+                          + (int32_t)(((int64_t)heading->slope_q16 * ((int32_t)far_row - HEADING_NEAR_ROW)) >> 8);
+    if (!Ground_Point(HEADING_NEAR_ROW, heading->offset_q8, &near)) return false;
+    if (!Ground_Point(far_row, far_offset_q8, &far)) return false;
+    return Ground_Line(&near, &far, line);
+}
@@ -0,0 +1,44 @@
+// line_heading.h
+#ifndef LINE_HEADING_H
+#define LINE_HEADING_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "bit_image.h"
+#include "ground.h"
+#include <stdbool.h>
+
+#define HEADING_NO_CENTRE INT16_MIN
+
+// Least-squares fit of x = a + b * y through one line centre per sampled row,
+// built row band by row band like LineProjection. All sums are integers: x in
+// half pixels (run start + end), y in rows, weights small integers.
+typedef struct {
+    int64_t s_w, s_y, s_x, s_yy, s_xy;
+    int16_t centre_q1[IMAGE_HEIGHT];    // Half pixels, HEADING_NO_CENTRE = row not used
+    int16_t track_q1;                   // Last accepted centre, the next row's reference
+    bool tracking;                      // A centre was accepted this frame
+    bool weighted;                      // Near rows count more
+    uint8_t row_step;                   // Only rows with y % row_step == 0
+    uint16_t window;                    // Search +-window pixels around the track, 0 = whole rows
+    uint16_t points;
+    uint32_t cycles;                    // DWT cycles spent on this frame so far
+} HeadingFit;
+
+// The fitted line relative to the robot. Row HEADING_NEAR_ROW is nearest.
+typedef struct {
+    int32_t slope_q16;          // dx / dy, pixels per row, Q16
+    int32_t heading_q15;        // Lean of the line towards the far rows, radians Q15, + = right
+    int32_t offset_q8;          // Fitted x at the near row minus image centre, 1/256 pixel
+    uint32_t residual_q16;      // RMS horizontal distance of the centres from the fit, pixels Q16
+    uint16_t points;
+    bool found;
+} LineHeading;
+
+void LineHeading_Clear(HeadingFit *fit, bool weighted, uint8_t row_step, int32_t seed_q8, uint16_t window);
+void LineHeading_AddRows(HeadingFit *fit, const BitImage *rows);
+void LineHeading_Estimate(HeadingFit *fit, LineHeading *out);
+bool LineHeading_Ground(const LineHeading *heading, GroundLine *line);
+int32_t LineHeading_Atan_q15(int32_t z_q16);
+
+#endif // LINE_HEADING_H
@@ -0,0 +1,109 @@
+// line_projection.c
+#include "line_projection.h"
+#include "bit_kernels.h"
+#include <string.h>
+
+// ============================================================================
+// Accumulation
+// ============================================================================
+
+void LineProjection_Clear(LineProjection *proj)
+{
+    memset(proj, 0, sizeof(*proj));
+}
+
+// Adds every row of a full-width view, usually one streamed band; the view's
+// y places it in the frame for the band counts. Each row word goes into the
+// counter planes as a ripple-carry add of 32 one-bit columns in parallel;
+// the carry dies out after about two planes on average. The band counts
+// cost one popcount per word on top.
+void LineProjection_AddRows(LineProjection *proj, const BitImage *rows)
+{
+    for (uint16_t r = 0; r < rows->height; r++) {
+        const uint32_t *row = BitImage_Row(rows, r);
+        uint16_t y = rows->y + r;
+
+        for (uint32_t w = 0; w < IMAGE_ROW_WORDS; w++) {
+            uint32_t carry = row[w];
+            for (uint32_t k = 0; carry != 0 && k < PROJECTION_PLANES; k++) {
+                uint32_t next = proj->planes[k][w] & carry;
+                proj->planes[k][w] ^= carry;
+                carry = next;
+            }
+        }
+
+        uint32_t count = BitKernel_PopcountWords(row, IMAGE_ROW_WORDS);
+        proj->band_counts[y / PROJECTION_BAND_ROWS] += (uint16_t)count;
+        proj->total += count;
+    }
+    proj->rows += rows->height;
+}
+
+// Un-slices the planes into one count per column
+void LineProjection_Columns(const LineProjection *proj, uint8_t columns[IMAGE_WIDTH])
+{
+    for (uint32_t w = 0; w < IMAGE_ROW_WORDS; w++) {
+        uint32_t p[PROJECTION_PLANES];
+        for (uint32_t k = 0; k < PROJECTION_PLANES; k++) p[k] = proj->planes[k][w];
+
+        for (uint32_t b = 0; b < 32; b++) {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < PROJECTION_PLANES; k++) {
+                count |= (p[k] & 1U) << k;
+                p[k] >>= 1;
+            }
+            columns[w * 32 + b] = (uint8_t)count;
+        }
+    }
+}
+
+// ============================================================================
+// Line Estimate
+// ============================================================================
+
+// Takes the highest column and grows the window while the neighbours stay
+// at or above half its height. The centre is the count-weighted mean of the
+// window. The width is the window's mass over the peak height, which is the
+// line width for a straight line and still sensible for a slanted one.
+// Confidence is the share of all line pixels inside the window times how
+// much of the rows the peak column spans.
+void LineProjection_Estimate(const LineProjection *proj, LineEstimate *est)
+{
+    uint8_t columns[IMAGE_WIDTH];
+
+    memset(est, 0, sizeof(*est));
+    if (proj->rows == 0 || proj->total < PROJECTION_MIN_PIXELS) return;
+
+    LineProjection_Columns(proj, columns);
+
+    uint16_t peak_x = 0;
+    for (uint16_t x = 1; x < IMAGE_WIDTH; x++) {
+        if (columns[x] > columns[peak_x]) peak_x = x;
+    }
+    uint32_t peak = columns[peak_x];
+    uint32_t half = (peak + 1) / 2;
+
+    uint16_t left = peak_x;
+    uint16_t right = peak_x;
+    while (left > 0 && columns[left - 1] >= half) left--;
+    while (right < IMAGE_WIDTH - 1 && columns[right + 1] >= half) right++;
+
+    uint32_t mass = 0;
+    uint32_t moment = 0;
+    for (uint16_t x = left; x <= right; x++) {
+        mass += columns[x];
+        moment += (uint32_t)x * columns[x];
+    }
+
+    // Pixel x covers [x, x + 1), so its centre is x + 0.5. Split the divide
+    // so moment * 256 can't overflow.
+    uint32_t centre_q8 = (moment / mass) * 256U + ((moment % mass) * 256U) / mass + 128U;
+    est->offset_q8 = (int32_t)centre_q8 - (int32_t)(IMAGE_WIDTH / 2) * 256;
+    est->width_q8 = (mass * 256U) / peak;
+
+    uint32_t share_q8 = (mass * 256U) / proj->total;
+    uint32_t span_q8 = (peak * 256U) / proj->rows;
+    est->confidence_q8 = (uint16_t)((share_q8 * span_q8) >> 8);
+    est->peak_column = peak_x;
+    est->found = true;
+}
@@ -0,0 +1,36 @@
+// line_projection.h
+#ifndef LINE_PROJECTION_H
+#define LINE_PROJECTION_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "bit_image.h"
+#include <stdbool.h>
+
+// Column projection of the line (set) pixels, built row band by row band so
+// it can follow a frame as it streams in. Columns are counted bit-sliced:
+// bit k of counter plane k, word w holds bit k of the count for the 32
+// columns of word w, so one row is added with a few word ops per word, not
+// per pixel.
+typedef struct {
+    uint32_t planes[PROJECTION_PLANES][IMAGE_ROW_WORDS];
+    uint16_t band_counts[PROJECTION_BANDS];     // Line pixels per PROJECTION_BAND_ROWS rows
+    uint32_t total;                             // Line pixels in every row added
+    uint16_t rows;                              // Rows added
+} LineProjection;
+
+// Where the line is, from one projection. Fixed point, Q8 = 1/256 pixel.
+typedef struct {
+    int32_t offset_q8;          // Line centre minus image centre, + = right
+    uint32_t width_q8;          // Line pixels in the peak / peak column height
+    uint16_t confidence_q8;     // 0 (none) .. 256 (one clean full-height line)
+    uint16_t peak_column;
+    bool found;
+} LineEstimate;
+
+void LineProjection_Clear(LineProjection *proj);
+void LineProjection_AddRows(LineProjection *proj, const BitImage *rows);
+void LineProjection_Columns(const LineProjection *proj, uint8_t columns[IMAGE_WIDTH]);
+void LineProjection_Estimate(const LineProjection *proj, LineEstimate *est);
+
+#endif // LINE_PROJECTION_H
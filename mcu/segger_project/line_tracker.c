@@ -0,0 +1,83 @@
+// line_tracker.c
+#include "line_tracker.h"
+#include <string.h>
+
+void LineTracker_Reset(LineTracker *t)
+{
+    memset(t, 0, sizeof(*t));
+}
+
+// One alpha-beta step on a value and its rate per frame, dt frames on
+static void alpha_beta(int32_t *x, int32_t *rate, int32_t z, uint32_t dt)
+{
+    int32_t predicted = *x + *rate * (int32_t)dt;
+    int32_t residual = z - predicted;
+
+    *x = predicted + (residual * TRACKER_ALPHA_Q8) / 256;
+    *rate += (residual * TRACKER_BETA_Q8) / (256 * (int32_t)dt);
+}
+
+// Takes this frame's estimates (heading may be NULL, e.g. sparse frames).
+// A measurement outside the search window is treated like no measurement:
+// the tracker coasts on its rates and the window widens, and after
+// TRACKER_MAX_MISSES frames it lets go and searches whole rows again.
+void LineTracker_Update(LineTracker *t, uint32_t sequence, const LineEstimate *est, const LineHeading *heading)
+{
+    uint32_t dt = sequence - t->sequence;
+    if (dt == 0) dt = 1;
+    if (dt > TRACKER_MAX_GAP) t->locked = false;       // Too old to predict from
+    t->sequence = sequence;
+
+    if (!t->locked) {
+        LineTracker_Reset(t);
+        t->sequence = sequence;
+        if (!est->found) return;
+
+        t->offset_q8 = est->offset_q8;
+        t->heading_q15 = (heading && heading->found) ? heading->heading_q15 : 0;
+        t->confidence_q8 = est->confidence_q8;
+        t->locked = true;
+        return;
+    }
+
+    int32_t window_q8 = (int32_t)LineTracker_Window(t) * 256;
+    int32_t predicted = t->offset_q8 + t->offset_rate_q8 * (int32_t)dt;
+    int32_t miss = est->offset_q8 - predicted;
+    if (miss < 0) miss = -miss;
+
+    if (!est->found || (window_q8 && miss > window_q8)) {
+        t->offset_q8 = predicted;
+        t->heading_q15 += t->heading_rate_q15 * (int32_t)dt;
+        t->confidence_q8 = 0;
+        if (++t->misses > TRACKER_MAX_MISSES) t->locked = false;
+        return;
+    }
+
+    alpha_beta(&t->offset_q8, &t->offset_rate_q8, est->offset_q8, dt);
+    if (heading && heading->found) {
+        alpha_beta(&t->heading_q15, &t->heading_rate_q15, heading->heading_q15, dt);
+    } else {
+        t->heading_q15 += t->heading_rate_q15 * (int32_t)dt;
+    }
+    t->confidence_q8 = est->confidence_q8;
+    t->misses = 0;
+}
+
+// Where the line should be on the next frame, as an offset from the centre
+int32_t LineTracker_Predict(const LineTracker *t)
+{
+    return t->offset_q8 + t->offset_rate_q8;
+}
+
+// Search half-width in pixels for the next frame, 0 = whole rows. Narrow
+// while the measurements are confident, wider as confidence drops, and
+// doubled for every frame missed.
+uint16_t LineTracker_Window(const LineTracker *t)
+{
+    if (!t->locked) return 0;
+
+    uint32_t doubt = 256U - ((t->confidence_q8 > 256U) ? 256U : t->confidence_q8);
+    uint32_t window = TRACKER_WINDOW_MIN + (((uint32_t)(TRACKER_WINDOW_MAX - TRACKER_WINDOW_MIN) * doubt) >> 8);
+    window <<= t->misses;
+    return (window >= IMAGE_WIDTH / 2) ? 0 : (uint16_t)window;
+}
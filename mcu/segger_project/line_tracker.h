@@ -0,0 +1,30 @@
+// line_tracker.h
+#ifndef LINE_TRACKER_H
+#define LINE_TRACKER_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "line_projection.h"
+#include "line_heading.h"
+#include <stdbool.h>
+
+// Alpha-beta filter on the line offset and heading across frames. Between
+// frames it predicts where the line will be, and the row searches of the
+// next frame only look within window pixels of that.
+typedef struct {
+    int32_t offset_q8;          // Filtered LineEstimate.offset_q8
+    int32_t offset_rate_q8;     // Change per frame
+    int32_t heading_q15;        // Filtered LineHeading.heading_q15
+    int32_t heading_rate_q15;
+    uint32_t sequence;          // Frame of the last update
+    uint16_t confidence_q8;     // Of the last measurement taken
+    uint8_t misses;             // Frames in a row without a usable measurement
+    bool locked;
+} LineTracker;
+
+void LineTracker_Reset(LineTracker *t);
+void LineTracker_Update(LineTracker *t, uint32_t sequence, const LineEstimate *est, const LineHeading *heading);
+int32_t LineTracker_Predict(const LineTracker *t);
+uint16_t LineTracker_Window(const LineTracker *t);
+
+#endif // LINE_TRACKER_H
@@ -4,6 +4,23 @@
 #include "ov7670.h"
 #include "camera_capture.h"
 #include "camera_vision.h"
+#include "spi.h"
+#include "spi_control_handshake.h"
+#include "latency_stats.h"
+#include "line_projection.h"
+#include "line_heading.h"
+#include "line_tracker.h"
+#include "morphology.h"
+#include "row_runs.h"
+#include "components.h"
+#include "scan_lines.h"
+#include "pyramid.h"
+#include "track_shape.h"
+#include "summed_area.h"
+#include "thinning.h"
+#include "ground.h"
+#include "bit_image.h"
+#include "vision_timing.h"
 #include <stdio.h>
 #include <stdbool.h>
 
@@ -11,9 +28,14 @@
 I2C_HandleTypeDef hi2c1;
 UART_HandleTypeDef huart2;
 SPI_HandleTypeDef hspi1;
+IWDG_HandleTypeDef hiwdg;
+CRC_HandleTypeDef hcrc;
 
 // Private Function Prototypes 
 void SystemClock_Config(void);
+void DWT_Init(void);
+void IWDG_Init(void);
+void CRC_Init(void);
 void I2C1_Init(void);
 void UART2_Init(void);
 void XCLK_Init(void);
@@ -22,21 +44,107 @@ void SPI1_Init(void);
 static void SPI1_GPIO_Init(void);
 void LPTIM2_PWM_Init(void);
 void check_reset(void);
-volatile bool spi_rx_error = false;
 void Robot_Control(void);
+#if CAPTURE_PARALLEL
+static void Robot_Control_Parallel(void);
+#else
+static void Robot_Control_Side(FrameSource side);
+#endif
+static void Robot_Act(FrameSource side, const FrameDescriptor *frame);
+static void Robot_Band(const FrameDescriptor *frame, uint16_t first_row, uint16_t num_rows);
+static uint32_t Robot_Vision_Full(FrameSource side, const FrameDescriptor *frame);
+static uint32_t Robot_Vision_Sparse(FrameSource side, const FrameDescriptor *frame);
+static void Robot_Vision_After(const FrameDescriptor *frame);
+static void Robot_Select_Mode(FrameSource side);
+
+// The two terminals of one side's motor. Each motor is driven only by the
+// camera on its own side.
+typedef struct {
+    GPIO_TypeDef *fwd_port;
+    uint16_t fwd_pin;
+    GPIO_TypeDef *rev_port;
+    uint16_t rev_pin;
+} MotorPins;
+
+static const MotorPins motors[NUM_CAMERAS] = {
+    [CAMERA_LEFT]  = { GPIOA, GPIO_PIN_9, GPIOB, GPIO_PIN_5 },
+    [CAMERA_RIGHT] = { GPIOB, GPIO_PIN_0, GPIOB, GPIO_PIN_1 },
+};
+
+// Line pixels per column and band, accumulated band by band while the frame is still arriving
+static LineProjection line_projection[NUM_CAMERAS];
+// Where each camera last saw the line, for steering and the live watch
+LineEstimate line_estimate[NUM_CAMERAS];
+// Line position and heading filtered across frames; its prediction seeds and
+// narrows the row searches of the next frame
+LineTracker line_tracker[NUM_CAMERAS];
+// Speckle filter over the chunks in flight, and the cycles it spent on the
+// frame. One stream serves both cameras: transfers never interleave.
+static MorphStream morph_stream;
+static uint32_t morph_cycles[NUM_CAMERAS];
+// Row-centre line fit, accumulated alongside the projection
+static HeadingFit heading_fit[NUM_CAMERAS];
+LineHeading line_heading[NUM_CAMERAS];
+// The line on the floor in mm, from whichever stage ran on the last frame
+GroundLine line_ground[NUM_CAMERAS];
+// Run list and blobs of the last frame processed. Shared by both cameras:
+// frames are handled one at a time and the tables are ~10 KB. The run list
+// is built from the filtered rows while the frame streams in, which is safe
+// because SpiControlHandshake_Poll() hands out a completed frame before the
+// next transfer's chunks come in.
+static RowRunList frame_runs;
+ComponentList frame_components;
+
+// Full-frame or lookahead-row analysis per camera. Set from the debugger, or
+// by Robot_Select_Mode() with VISION_MODE_AUTO. A frame keeps the mode it
+// started streaming in.
+VisionMode vision_mode[NUM_CAMERAS];
+static VisionMode streamed_mode[NUM_CAMERAS];
+static const uint8_t scan_rows[] = SCAN_LINE_ROWS;
+// Per-row line positions from the last sparse frame
+ScanLines scan_lines[NUM_CAMERAS];
+// Coarse levels for finding a lost line on a sparse frame, shared by both cameras
+static Pyramid pyramid;
+// What the track does ahead (straight, curve, cross, T, gap, end), from each
+// camera's last frame. The fit runs after a frame is complete, one frame at
+// a time, so both cameras share it.
+static ShapeFit shape_fit;
+TrackShape track_shape[NUM_CAMERAS];
+// Line pixels per 8x8 cell, summed, for constant-time region densities of
+// the last full frame. Streamed from the filtered rows and shared by both
+// cameras, like the run list.
+SummedArea frame_sat;
+// One-pixel centreline points of the last full frame, nearest first, for
+// curve fitting. Shared by both cameras like the run list; source and
+// sequence say whose frame it is.
+#if THIN_CENTRELINE
+Centreline frame_centreline;
+#endif
 
 int main(void)
 {
     HAL_Init();
     SystemClock_Config();
     check_reset();
+    DWT_Init();
+    LatencyStats_Init();
 
     // Initialize peripherals
     //UART2_Init();
     I2C1_Init();
     GPIO_Capture_Init();
     SPI1_Init();
+    CRC_Init();
+#if CAPTURE_PARALLEL
+    FramePool_Init();
+#else
+    SpiControlHandshake_Init();
+#endif
     XCLK_Init();
+#if CAPTURE_PARALLEL
+    // PCLK capture runs on TIM1, which XCLK_Init() just started
+    capture_dma_init();
+#endif
     LPTIM2_PWM_Init();
     HAL_Delay(300);  
     
@@ -50,9 +158,32 @@ int main(void)
     }
     HAL_Delay(1000); 
     
+#if !CAPTURE_PARALLEL
+    // Settle each camera's SPI rate before the bus is shared
+    SpiControlHandshake_Calibrate();
+
+    // First frame transfers in the background from here on
+    SpiControlHandshake_SetBandCallback(Robot_Band, STREAM_BAND_ROWS);
+    SpiControlHandshake_BeginCapture(CAMERA_LEFT);
+    SpiControlHandshake_BeginCapture(CAMERA_RIGHT);
+#endif
+
+    // Robot_Control() never blocks (the parallel path for at most
+    // CAPTURE_WAIT_TIMEOUT_MS + CAPTURE_PARALLEL_TIMEOUT_MS), so a missed
+    // refresh means a real hang
+    IWDG_Init();
+
     //Control the robot on the line
+    uint32_t last_report = HAL_GetTick();
     while (1) {
         Robot_Control();
+        HAL_IWDG_Refresh(&hiwdg);
+
+        // Latency numbers on RTT channel 1, never blocks
+        if (HAL_GetTick() - last_report >= LATENCY_REPORT_MS) {
+            last_report = HAL_GetTick();
+            LatencyStats_Report();
+        }
     }
 }
 
@@ -163,7 +294,7 @@ void GPIO_Capture_Init(void) {
 
     // Configure Motor driver GPIO
     GPIO_InitTypeDef GPIO_InitStru = {0};
-    GPIO_InitStru.Pin = GPIO_PIN_5;
+    GPIO_InitStru.Pin = GPIO_PIN_5 | GPIO_PIN_0 | GPIO_PIN_1;
     GPIO_InitStru.Pull = GPIO_NOPULL;
     GPIO_InitStru.Mode = GPIO_MODE_OUTPUT_PP;
     GPIO_InitStru.Speed = GPIO_SPEED_FREQ_HIGH;
@@ -175,17 +306,17 @@ void SPI1_Init(void)
 {
     __HAL_RCC_SPI1_CLK_ENABLE();
     SPI1_GPIO_Init();
-    //SPI1_DMA_Init();
+    SPI1_DMA_Init();
 
     hspi1.Instance = SPI1;
     hspi1.Init.Mode = SPI_MODE_MASTER;
     hspi1.Init.Direction = SPI_DIRECTION_2LINES_RXONLY;
-    hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi1.Init.DataSize = SPI_DATASIZE_16BIT;    // One SPRAM word per frame
     hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;     // SPI mode 0
     hspi1.Init.CLKPhase    = SPI_PHASE_1EDGE;
     hspi1.Init.NSS         = SPI_NSS_SOFT;         // manage CS in GPIO
     hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_8;
-    hspi1.Init.FirstBit    = SPI_FIRSTBIT_MSB;
+    hspi1.Init.FirstBit    = SPI_FIRSTBIT_LSB;    // FPGA shifts bit 0 out first
     hspi1.Init.TIMode      = SPI_TIMODE_DISABLE;
     hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
     hspi1.Init.CRCPolynomial  = 7;
@@ -202,14 +333,24 @@ static void SPI1_GPIO_Init(void)
 
     __HAL_RCC_GPIOA_CLK_ENABLE();
 
-    /* SPI1 SCK: PB3, MISO: PB4
-       (MOSI PA7 is unused in master RX-only mode) */
+    /* SPI1 SCK: PB3, MISO: PB4 */
     GPIO_InitStruct.Pin = GPIO_PIN_3 | GPIO_PIN_4;
     GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
     GPIO_InitStruct.Pull = GPIO_NOPULL;
     GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
     GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
     HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    /* SPI1 MOSI: PA7, only driven while a band header is sent */
+    GPIO_InitStruct.Pin = GPIO_PIN_7;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    /* One band request chip select per FPGA, idle high */
+    HAL_GPIO_WritePin(GPIOA, SPI_CS_LEFT_PIN | SPI_CS_RIGHT_PIN, GPIO_PIN_SET);
+    GPIO_InitStruct.Pin = SPI_CS_LEFT_PIN | SPI_CS_RIGHT_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Alternate = 0;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 }
 
 void SystemClock_Config(void) {
@@ -239,6 +380,46 @@ void SystemClock_Config(void) {
     HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_4);
 }
 
+// Free-running cycle counter used to timestamp frames
+void DWT_Init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Independent watchdog on the ~32 kHz LSI: /32 gives 1 ms per reload count
+void IWDG_Init(void) {
+    // Keep the watchdog from firing while halted in the debugger
+    DBGMCU->APB1FZR1 |= DBGMCU_APB1FZR1_DBG_IWDG_STOP;
+
+    hiwdg.Instance = IWDG;
+    hiwdg.Init.Prescaler = IWDG_PRESCALER_32;
+    hiwdg.Init.Reload = WATCHDOG_TIMEOUT_MS;
+    hiwdg.Init.Window = IWDG_WINDOW_DISABLE;
+
+    if (HAL_IWDG_Init(&hiwdg) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+// CRC-32 (0x04C11DB7, init 0xFFFFFFFF) matching the FPGA's band trailer.
+// Each input word is bit-reversed, so the unit consumes a little-endian
+// frame word bit 0 first, the same order the FPGA shifted the bits out.
+void CRC_Init(void) {
+    __HAL_RCC_CRC_CLK_ENABLE();
+
+    hcrc.Instance = CRC;
+    hcrc.Init.DefaultPolynomialUse = DEFAULT_POLYNOMIAL_ENABLE;
+    hcrc.Init.DefaultInitValueUse = DEFAULT_INIT_VALUE_ENABLE;
+    hcrc.Init.InputDataInversionMode = CRC_INPUTDATA_INVERSION_WORD;
+    hcrc.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE;
+    hcrc.InputDataFormat = CRC_INPUTDATA_FORMAT_WORDS;
+
+    if (HAL_CRC_Init(&hcrc) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
 void Error_Handler(void) {
     __disable_irq();
     while (1) {}
@@ -318,31 +499,279 @@ void check_reset(void) {
   }
 }
 
+// Both sides run every pass; each only acts when its own camera has
+// delivered, so neither waits on the other's frame
 void Robot_Control(void) {
-    capture_frame_spi();
+#if CAPTURE_PARALLEL
+    Robot_Control_Parallel();
+#else
+    Robot_Control_Side(CAMERA_LEFT);
+    Robot_Control_Side(CAMERA_RIGHT);
+#endif
+}
+
+#if !CAPTURE_PARALLEL
+static void Robot_Control_Side(FrameSource side) {
+    const MotorPins *motor = &motors[side];
+    FrameDescriptor *frame;
+    SpiCaptureStatus status = SpiControlHandshake_Poll(side, &frame);
+
+    if (status == SPI_CAPTURE_TIMEOUT) {
+        // No camera data: STOP rather than keep the last command
+        HAL_GPIO_WritePin(motor->fwd_port, motor->fwd_pin, 0);
+        HAL_GPIO_WritePin(motor->rev_port, motor->rev_pin, 0);
+        return;
+    }
+    if (status == SPI_CAPTURE_STALE) return;
+
+    Robot_Act(side, frame);
+    SpiControlHandshake_ReleaseFrame(frame);
+}
+#endif
+
+// Parallel-pin fallback: one camera, captured whole and blocking, then fed
+// to the same stages in STREAM_BAND_ROWS chunks as a streamed frame. PCLK
+// takes the left motor's forward pin, so the frame steers the right motor.
+#if CAPTURE_PARALLEL
+static void Robot_Control_Parallel(void) {
+    static uint32_t sequence = 0;
+    const MotorPins *motor = &motors[CAMERA_RIGHT];
+    FrameDescriptor *frame = FramePool_Acquire();
+    if (frame == NULL) return;
+
+    frame->source = CAMERA_RIGHT;
+    frame->sequence = ++sequence;
+    capture_frame(frame);
+
+    // A partial frame is read like a ROI of its whole rows
+    uint16_t rows = frame->valid_bytes / IMAGE_ROW_BYTES;
+    if (rows == 0) {
+        // No camera data: STOP rather than keep the last command
+        HAL_GPIO_WritePin(motor->fwd_port, motor->fwd_pin, 0);
+        HAL_GPIO_WritePin(motor->rev_port, motor->rev_pin, 0);
+        FramePool_Release(frame);
+        return;
+    }
+    frame->bands[0].first_row = 0;
+    frame->bands[0].num_rows = (uint8_t)rows;
+    frame->num_bands = 1;
+
+    for (uint16_t r = 0; r < rows; r += STREAM_BAND_ROWS) {
+        Robot_Band(frame, r, (rows - r < STREAM_BAND_ROWS) ? rows - r : STREAM_BAND_ROWS);
+    }
+    Robot_Act(CAMERA_RIGHT, frame);
+    FramePool_Release(frame);
+}
+#endif
+
+// Finishes the vision on a complete frame and drives that side's motor
+static void Robot_Act(FrameSource side, const FrameDescriptor *frame) {
+    const MotorPins *motor = &motors[side];
+
+    // DMA keeps filling the other buffer while we work on this one.
+    // Both modes leave line_estimate[side] and the white count the same way.
+    uint32_t white_pixels = (streamed_mode[side] == VISION_SPARSE)
+                          ? Robot_Vision_Sparse(side, frame)
+                          : Robot_Vision_Full(side, frame);
+    LineTracker_Update(&line_tracker[side], frame->sequence, &line_estimate[side],
+                       (streamed_mode[side] == VISION_FULL) ? &line_heading[side] : NULL);
+#if VISION_MODE_AUTO
+    Robot_Select_Mode(side);
+#endif
+    
+    // FORWARD: fwd = 1, rev = 0
+    // STOP:    fwd = 0, rev = 0
+    const TrackShape *shape = &track_shape[side];
+    if (shape->kind == TRACK_CROSS && shape->confidence_q8 >= SHAPE_ACT_Q8) {
+        // === CROSSING AHEAD ===
+        // The bar floods both sides with black; drive straight over it
+        // instead of stopping on it
+        HAL_GPIO_WritePin(motor->fwd_port, motor->fwd_pin, 1);
+        HAL_GPIO_WritePin(motor->rev_port, motor->rev_pin, 0);
+    }
+    else if (white_pixels < THRESHOLD_BLACK) {
+        // === BLACK DETECTED (LINE) ===
+
+            // STOP the motor to let the other side pivot
+        HAL_GPIO_WritePin(motor->fwd_port, motor->fwd_pin, 0); 
+        HAL_GPIO_WritePin(motor->rev_port, motor->rev_pin, 0); 
+
+    } 
+    else if (white_pixels > THRESHOLD_WHITE) {
+        // === WHITE DETECTED (FLOOR) ===
+        // DRIVE the motor Forward
+        HAL_GPIO_WritePin(motor->fwd_port, motor->fwd_pin, 1);
+        HAL_GPIO_WritePin(motor->rev_port, motor->rev_pin, 0);
+    }
+    LatencyStats_Record(frame, DWT->CYCCNT);
     
-    if (pixel_count >= 76000) {
-        uint32_t white_pixels = count_white_pixels();
-        
-        // PA9 and PB5 are terminals for the SAME motor.
-        // FORWARD: PA9 = 1, PB5 = 0
-        // STOP:    PA9 = 0, PB5 = 0
-        if (white_pixels < THRESHOLD_BLACK) {
-            // === BLACK DETECTED (LINE) ===
-
-                // STOP the motor to let the other side pivot
-            HAL_GPIO_WritePin(GPIOA, GPIO_PIN_9, 0); 
-            HAL_GPIO_WritePin(GPIOB, GPIO_PIN_5, 0); 
-
-        } 
-        else if (white_pixels > THRESHOLD_WHITE) {
-            // === WHITE DETECTED (FLOOR) ===
-            // DRIVE the motor Forward
-            HAL_GPIO_WritePin(GPIOA, GPIO_PIN_9, 1);
-            HAL_GPIO_WritePin(GPIOB, GPIO_PIN_5, 0);
+    // Debug LED toggle
+    HAL_GPIO_TogglePin(GPIOB, GPIO_PIN_3);
+
+    if (streamed_mode[side] == VISION_FULL) {
+        Robot_Vision_After(frame);
+#if VISION_BENCHMARK
+        // After the motor write so it stays out of the latency stats, and in
+        // this frame's run list and projection, which are no longer needed
+        if (frame->sequence % VISION_BENCHMARK_FRAMES == 0) {
+            vision_benchmark(frame->data, &line_projection[side], &frame_runs);
         }
-        
-        // Debug LED toggle
-        HAL_GPIO_TogglePin(GPIOB, GPIO_PIN_3);
+#endif
+    }
+}
+
+// Streaming callback: projects each band as soon as it lands, so a side's motor
+// decision is ready the moment the last row of its frame arrives. The first
+// chunk starts at the first ROI row, which is not row 0 with a ROI set.
+static void Robot_Band(const FrameDescriptor *frame, uint16_t first_row, uint16_t num_rows) {
+    FrameSource side = frame->source;
+    LineProjection *proj = &line_projection[side];
+    HeadingFit *fit = &heading_fit[side];
+    if (first_row == frame->bands[0].first_row) {
+        streamed_mode[side] = vision_mode[side];
+        LineProjection_Clear(proj);
+        // Start the row tracking where the tracker expects the line
+        const LineTracker *tracker = &line_tracker[side];
+        LineHeading_Clear(fit, HEADING_WEIGHTED, HEADING_ROW_STEP,
+                          LineTracker_Predict(tracker), LineTracker_Window(tracker));
+        RowRuns_Begin(&frame_runs, first_row);
+        SummedArea_Clear(&frame_sat);
+        morph_cycles[side] = 0;
+    }
+    // Sparse frames are only looked at once they're complete
+    if (streamed_mode[side] == VISION_SPARSE) return;
+
+    // Each ROI band is filtered as one view whatever the chunk size; a chunk
+    // never straddles two bands
+    const FrameBand *band = frame->bands;
+    while (first_row >= band->first_row + band->num_rows && band + 1 < frame->bands + frame->num_bands) {
+        band++;
     }
-}
\ No newline at end of file
+
+    BitImage img = BitImage_Frame(frame->data);
+    BitImage chunk = BitImage_Rows(&img, first_row, num_rows);
+    if (first_row == band->first_row) {
+        MorphStream_Begin(&morph_stream, MORPH_FILTER, MORPH_FILTER_SHAPE, chunk.width);
+    }
+    MorphStream_Add(&morph_stream, &chunk, first_row + num_rows >= band->first_row + band->num_rows);
+
+    // Filtered rows trail the chunk by up to two rows and land in the
+    // stream's own row buffer; the frame stays as received for its other
+    // owners
+    BitImage row;
+    while (MorphStream_Next(&morph_stream, &row)) {
+        LineProjection_AddRows(proj, &row);
+        LineHeading_AddRows(fit, &row);
+        RowRuns_AddRows(&frame_runs, &row);
+        SummedArea_AddRows(&frame_sat, &row);
+    }
+    morph_cycles[side] += morph_stream.cycles;
+    morph_stream.cycles = 0;
+}
+
+// Full-frame analysis. The projection, heading fit and run list were
+// already built from the filtered rows during the transfer by Robot_Band();
+// this finishes what the motor decision reads. Returns the white pixel
+// count.
+static uint32_t Robot_Vision_Full(FrameSource side, const FrameDescriptor *frame) {
+    const LineProjection *proj = &line_projection[side];
+
+    VisionTiming_RecordCycles(&vision_timing.morph, morph_cycles[side]);
+    LineProjection_Estimate(proj, &line_estimate[side]);
+    LineHeading_Estimate(&heading_fit[side], &line_heading[side]);
+    LineHeading_Ground(&line_heading[side], &line_ground[side]);
+
+    // What's ahead, from the same runs; cost lands in vision_timing.shape.
+    // With no lock the prediction is stale, so the shape starts from the line
+    // found on the coarse levels instead. The heading fit can't: it was
+    // seeded at the first band, before the frame was there to downsample.
+    int32_t seed_q8 = LineTracker_Predict(&line_tracker[side]);
+    if (!line_tracker[side].locked) {
+        BitImage img = BitImage_Frame(frame->data);
+        uint16_t window;
+        Pyramid_Build(&pyramid, &img, frame);
+        Pyramid_FindLine(&pyramid, &seed_q8, &window);
+    }
+    TrackShape_Clear(&shape_fit, seed_q8);
+    TrackShape_AddRuns(&shape_fit, &frame_runs, frame);
+    TrackShape_Estimate(&shape_fit, &track_shape[side]);
+
+    return (uint32_t)proj->rows * IMAGE_WIDTH - proj->total;
+}
+
+// Full-frame stages the motor decision doesn't read. They run once the
+// motor pins are written, so their cost stays out of the frame-to-motor
+// latency, and before the frame's run list can be replaced.
+static void Robot_Vision_After(const FrameDescriptor *frame) {
+    // Track topology; cost lands in vision_timing.components
+    Components_Label(&frame_components, &frame_runs);
+
+    // Region densities: the cell rows below the last band are closed here,
+    // the rest were built as the frame streamed in. Cost lands in
+    // vision_timing.summed_area
+    SummedArea_Finish(&frame_sat);
+
+#if THIN_CENTRELINE
+    // Centreline, from the filtered runs painted into a spare pool frame.
+    // While every frame is in use it is emptied and the skip counted. Cost
+    // lands in vision_timing.thinning
+    FrameDescriptor *scratch = FramePool_Acquire();
+    if (scratch != NULL) {
+        Thinning_Runs(&frame_runs, frame, (uint32_t *)scratch->data, &frame_centreline);
+        FramePool_Release(scratch);
+    } else {
+        Thinning_Skip(frame, &frame_centreline);
+    }
+#else
+    (void)frame;
+#endif
+}
+
+// Lookahead rows only. The white count is scaled up to the rows the frame
+// transferred so the same thresholds apply.
+static uint32_t Robot_Vision_Sparse(FrameSource side, const FrameDescriptor *frame) {
+    ScanLines *scan = &scan_lines[side];
+
+    const LineTracker *tracker = &line_tracker[side];
+    int32_t seed_q8 = LineTracker_Predict(tracker);
+    uint16_t window = LineTracker_Window(tracker);
+
+    BitImage img = BitImage_Frame(frame->data);
+
+    // Nothing to predict from: find the line on the coarse levels first and
+    // only search there at full resolution
+    if (!tracker->locked) {
+        Pyramid_Build(&pyramid, &img, frame);
+        if (!Pyramid_FindLine(&pyramid, &seed_q8, &window)) window = 0;
+    }
+
+    ScanLines_Analyse(scan, &img, frame, scan_rows, sizeof(scan_rows), seed_q8, window);
+    ScanLines_Estimate(scan, &line_estimate[side]);
+    ScanLines_Ground(scan, &line_ground[side]);
+
+    // The scan lines skip runs too wide to be the line, so the shape reads
+    // the same rows again with nothing dropped
+    TrackShape_Clear(&shape_fit, seed_q8);
+    TrackShape_AddImageRows(&shape_fit, &img, frame, scan_rows, sizeof(scan_rows));
+    TrackShape_Estimate(&shape_fit, &track_shape[side]);
+    return ScanLines_WhitePixels(scan, frame->valid_bytes / IMAGE_ROW_BYTES);
+}
+
+// Drops to sparse rows while the full-frame view shows one clean, nearly
+// straight line, and goes back to full frames as soon as the lookahead rows
+// lose it or see anything but a straight line coming
+static void Robot_Select_Mode(FrameSource side) {
+    const LineEstimate *est = &line_estimate[side];
+    bool straight = track_shape[side].kind == TRACK_STRAIGHT;
+
+    if (vision_mode[side] == VISION_FULL) {
+        int32_t heading = line_heading[side].heading_q15;
+        if (heading < 0) heading = -heading;
+        if (est->found && straight && est->confidence_q8 >= SCAN_LINES_ENTER_Q8 &&
+            heading <= SCAN_LINES_ENTER_HEADING_Q15) {
+            vision_mode[side] = VISION_SPARSE;
+        }
+    } else if (!est->found || !straight || est->confidence_q8 < SCAN_LINES_EXIT_Q8) {
+        vision_mode[side] = VISION_FULL;
+    }
+}
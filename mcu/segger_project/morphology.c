@@ -0,0 +1,271 @@
+// morphology.c
+#include "morphology.h"
+#include <stdbool.h>
+#include <string.h>
+
+// ============================================================================
+// Rows
+// ============================================================================
+
+// Each pixel combined with its left and right neighbours. Pixel x - 1 sits
+// one bit below pixel x, so shifting the row left by one lines it up with x.
+// Past the row ends is "edge": set for erosion (the image border doesn't eat
+// the line), clear for dilation.
+static void row_horizontal(uint32_t *out, const uint32_t *in, uint32_t words, bool erode)
+{
+    uint32_t edge = erode ? 1U : 0U;
+
+    for (uint32_t w = 0; w < words; w++) {
+        uint32_t left = (in[w] << 1) | (w > 0 ? in[w - 1] >> 31 : edge);
+        uint32_t right = (in[w] >> 1) | ((w < words - 1 ? in[w + 1] & 1U : edge) << 31);
+        out[w] = erode ? (in[w] & left & right) : (in[w] | left | right);
+    }
+}
+
+// Copies a source row, with the bits past the view's width set to the edge
+// value so they act like the border
+static void load_row(uint32_t *out, const uint32_t *in, uint32_t words, uint32_t last_mask, bool erode)
+{
+    memcpy(out, in, words * sizeof(uint32_t));
+    if (erode) out[words - 1] |= ~last_mask;
+    else out[words - 1] &= last_mask;
+}
+
+// The three-row window: the slots are the source rows above, at and below
+// the output row (raw) and the same rows combined horizontally (hor)
+static void window_fill(MorphWindow *win, uint8_t slot, uint32_t words, bool erode)
+{
+    uint32_t fill = erode ? 0xFFFFFFFFU : 0U;
+    memset(win->raw[slot], (int)fill, words * sizeof(uint32_t));
+    memset(win->hor[slot], (int)fill, words * sizeof(uint32_t));
+}
+
+static void window_load(MorphWindow *win, uint8_t slot, const uint32_t *in, uint32_t words,
+                        uint32_t last_mask, bool erode)
+{
+    load_row(win->raw[slot], in, words, last_mask, erode);
+    row_horizontal(win->hor[slot], win->raw[slot], words, erode);
+}
+
+// Square: the horizontal result of all three rows. Cross: the horizontal
+// result of this row plus the bare pixels above and below. Writes all words,
+// including the bits of the last one past the view's width.
+static void window_combine(const MorphWindow *win, uint32_t *out, uint32_t words, MorphShape shape, bool erode)
+{
+    const uint32_t *here = win->hor[win->here];
+    const uint32_t *up = (shape == MORPH_SQUARE) ? win->hor[win->above] : win->raw[win->above];
+    const uint32_t *down = (shape == MORPH_SQUARE) ? win->hor[win->below] : win->raw[win->below];
+
+    for (uint32_t w = 0; w < words; w++) {
+        out[w] = erode ? (here[w] & up[w] & down[w]) : (here[w] | up[w] | down[w]);
+    }
+}
+
+static void window_rotate(MorphWindow *win)
+{
+    uint8_t t = win->above;
+    win->above = win->here;
+    win->here = win->below;
+    win->below = t;
+}
+
+// One erosion or dilation pass. The window rotates down one row per step,
+// so the source row is read once even when dst == src. Rows outside the
+// view read as the edge value, and dst bits past its width are left alone.
+static void pass(const BitImage *dst, const BitImage *src, MorphShape shape, bool erode)
+{
+    MorphWindow win = { .above = 0, .here = 1, .below = 2 };
+    uint16_t num_rows = src->height;
+    uint32_t words = BitImage_RowWords(src);
+    uint32_t last_mask = BitImage_LastMask(src);
+
+    if (num_rows == 0 || words == 0) return;
+    if (words > IMAGE_ROW_WORDS) words = IMAGE_ROW_WORDS;
+
+    window_fill(&win, win.above, words, erode);
+    window_load(&win, win.here, BitImage_Row(src, 0), words, last_mask, erode);
+
+    for (uint16_t r = 0; r < num_rows; r++) {
+        if (r + 1 < num_rows) {
+            window_load(&win, win.below, BitImage_Row(src, r + 1), words, last_mask, erode);
+        } else {
+            window_fill(&win, win.below, words, erode);
+        }
+
+        uint32_t *out = BitImage_Row(dst, r);
+        uint32_t keep = out[words - 1] & ~last_mask;
+        window_combine(&win, out, words, shape, erode);
+        out[words - 1] = keep | (out[words - 1] & last_mask);
+
+        window_rotate(&win);
+    }
+}
+
+// ============================================================================
+// Operations
+// ============================================================================
+
+void Morph_Erode(const BitImage *dst, const BitImage *src, MorphShape shape)
+{
+    pass(dst, src, shape, true);
+}
+
+void Morph_Dilate(const BitImage *dst, const BitImage *src, MorphShape shape)
+{
+    pass(dst, src, shape, false);
+}
+
+void Morph_Open(const BitImage *dst, const BitImage *src, MorphShape shape)
+{
+    pass(dst, src, shape, true);
+    pass(dst, dst, shape, false);
+}
+
+void Morph_Close(const BitImage *dst, const BitImage *src, MorphShape shape)
+{
+    pass(dst, src, shape, false);
+    pass(dst, dst, shape, true);
+}
+
+uint32_t Morph_Apply(MorphOp op, const BitImage *dst, const BitImage *src, MorphShape shape)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    switch (op) {
+        case MORPH_ERODE:  Morph_Erode(dst, src, shape); break;
+        case MORPH_DILATE: Morph_Dilate(dst, src, shape); break;
+        case MORPH_OPEN:   Morph_Open(dst, src, shape); break;
+        case MORPH_CLOSE:  Morph_Close(dst, src, shape); break;
+        default:
+            if (dst->base != src->base) {
+                for (uint16_t r = 0; r < src->height; r++) {
+                    memcpy(BitImage_Row(dst, r), BitImage_Row(src, r), BitImage_RowWords(src) * sizeof(uint32_t));
+                }
+            }
+            break;
+    }
+    return DWT->CYCCNT - start;
+}
+
+// ============================================================================
+// Streaming
+// ============================================================================
+
+void MorphStream_Begin(MorphStream *ms, MorphOp op, MorphShape shape, uint16_t width)
+{
+    BitImage shape_of = BitImage_Make(NULL, width, 0, 0);
+
+    ms->shape = shape;
+    ms->width = width;
+    ms->words = BitImage_RowWords(&shape_of);
+    ms->last_mask = BitImage_LastMask(&shape_of);
+    if (ms->words > IMAGE_ROW_WORDS) ms->words = IMAGE_ROW_WORDS;
+
+    // Open and close are the two passes of Morph_Open() / Morph_Close()
+    switch (op) {
+        case MORPH_ERODE:  ms->num_stages = 1; ms->stage[0].erode = true; break;
+        case MORPH_DILATE: ms->num_stages = 1; ms->stage[0].erode = false; break;
+        case MORPH_OPEN:   ms->num_stages = 2; ms->stage[0].erode = true; ms->stage[1].erode = false; break;
+        case MORPH_CLOSE:  ms->num_stages = 2; ms->stage[0].erode = false; ms->stage[1].erode = true; break;
+        default:           ms->num_stages = 0; break;
+    }
+    if (ms->words == 0) ms->num_stages = 0;
+
+    for (uint8_t k = 0; k < 2; k++) {
+        ms->stage[k].win.above = 0;
+        ms->stage[k].win.here = 1;
+        ms->stage[k].win.below = 2;
+        ms->stage[k].started = false;
+        ms->stage[k].flushed = false;
+    }
+    ms->in = BitImage_Make(NULL, width, 0, 0);
+    ms->next = 0;
+    ms->last = false;
+}
+
+// The caller takes every row Next() gives before adding the next chunk
+void MorphStream_Add(MorphStream *ms, const BitImage *rows, bool last)
+{
+    ms->in = *rows;
+    ms->next = 0;
+    ms->last = last;
+}
+
+// Feeds a stage its next source row, or NULL once the view has ended (the
+// row below the last one is the edge value). Returns true with the output
+// row for the row above in out once there is one.
+static bool stage_push(const MorphStream *ms, MorphStage *st, const uint32_t *in, uint16_t y,
+                       uint32_t *out, uint16_t *out_y)
+{
+    MorphWindow *win = &st->win;
+
+    if (in == NULL) {
+        if (!st->started || st->flushed) return false;
+        window_fill(win, win->below, ms->words, st->erode);
+        st->flushed = true;
+    } else if (!st->started) {
+        window_fill(win, win->above, ms->words, st->erode);
+        window_load(win, win->here, in, ms->words, ms->last_mask, st->erode);
+        st->started = true;
+        st->y = y;
+        return false;
+    } else {
+        window_load(win, win->below, in, ms->words, ms->last_mask, st->erode);
+    }
+
+    window_combine(win, out, ms->words, ms->shape, st->erode);
+    out[ms->words - 1] &= ms->last_mask;
+    *out_y = st->y++;
+    window_rotate(win);
+    return true;
+}
+
+// Stage k's next output row, pulling source rows through the stages before
+// it. False when it needs rows the stream doesn't have yet, or is done.
+static bool stage_pull(MorphStream *ms, uint8_t k, uint32_t *out, uint16_t *out_y)
+{
+    MorphStage *st = &ms->stage[k];
+
+    for (;;) {
+        const uint32_t *in = NULL;
+        uint16_t y = 0;
+
+        if (k == 0) {
+            if (ms->next < ms->in.height) {
+                y = ms->in.y + ms->next;
+                in = BitImage_Row(&ms->in, ms->next++);
+            } else if (!ms->last) {
+                return false;
+            }
+        } else if (stage_pull(ms, k - 1, ms->carry, &y)) {
+            in = ms->carry;
+        } else if (!ms->stage[k - 1].flushed) {
+            return false;
+        }
+
+        if (stage_push(ms, st, in, y, out, out_y)) return true;
+        if (in == NULL) return false;
+    }
+}
+
+bool MorphStream_Next(MorphStream *ms, BitImage *row)
+{
+    uint32_t start = DWT->CYCCNT;
+    bool found;
+
+    if (ms->num_stages == 0) {
+        found = ms->next < ms->in.height;
+        if (found) *row = BitImage_Rows(&ms->in, ms->next++, 1);
+    } else {
+        uint16_t y;
+        found = stage_pull(ms, ms->num_stages - 1, ms->out, &y);
+        if (found) {
+            *row = BitImage_Make(ms->out, ms->width, 1, IMAGE_ROW_WORDS);
+            row->x = ms->in.x;
+            row->y = y;
+        }
+    }
+
+    ms->cycles += DWT->CYCCNT - start;
+    return found;
+}
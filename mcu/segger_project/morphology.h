@@ -0,0 +1,86 @@
+// morphology.h
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "bit_image.h"
+
+// Binary morphology on packed views, 32 pixels per word op. Horizontal
+// neighbours are the row shifted by one bit (with the carry from the next
+// word), vertical neighbours are the rows above and below. dst and src are
+// views of the same size, at most IMAGE_WIDTH wide, and may be the same
+// view: the source rows are buffered before they're overwritten. Pixels
+// outside the view never change the result, so a streamed band can be
+// filtered before the next one arrives.
+
+typedef enum {
+    MORPH_CROSS = 0,            // Centre and its 4 neighbours
+    MORPH_SQUARE = 1            // Full 3x3
+} MorphShape;
+
+typedef enum {
+    MORPH_NONE = 0,
+    MORPH_ERODE,
+    MORPH_DILATE,
+    MORPH_OPEN,                 // Erode then dilate: removes line speckle
+    MORPH_CLOSE                 // Dilate then erode: fills holes in the line
+} MorphOp;
+
+void Morph_Erode(const BitImage *dst, const BitImage *src, MorphShape shape);
+void Morph_Dilate(const BitImage *dst, const BitImage *src, MorphShape shape);
+void Morph_Open(const BitImage *dst, const BitImage *src, MorphShape shape);
+void Morph_Close(const BitImage *dst, const BitImage *src, MorphShape shape);
+
+// Any of the above by MorphOp; returns the DWT cycles it took
+uint32_t Morph_Apply(MorphOp op, const BitImage *dst, const BitImage *src, MorphShape shape);
+
+// Source rows above, at and below the output row, as read (raw) and
+// combined horizontally (hor); the slots rotate down one row per step
+typedef struct {
+    uint32_t raw[3][IMAGE_ROW_WORDS];
+    uint32_t hor[3][IMAGE_ROW_WORDS];
+    uint8_t above, here, below;
+} MorphWindow;
+
+typedef struct {
+    MorphWindow win;
+    bool erode;
+    bool started;               // The window holds the view's first row
+    bool flushed;               // The view's last row is out
+    uint16_t y;                 // Frame row of the window's centre row
+} MorphStage;
+
+// A MorphOp over one view that arrives in chunks, with the same result as
+// Morph_Apply() on the whole view: each pass keeps its window across chunk
+// edges, so only the view's own top and bottom rows see the edge value.
+// Filtered rows come out one row (erode, dilate) or two rows (open, close)
+// behind the source rows and are written to the stream's own row, never
+// back to the source.
+//
+//   MorphStream_Begin(&ms, op, shape, width);
+//   for each chunk of the view, top to bottom:
+//       MorphStream_Add(&ms, &chunk, is_last_chunk);
+//       while (MorphStream_Next(&ms, &row)) use row;
+typedef struct {
+    MorphStage stage[2];        // Open and close are two passes
+    uint8_t num_stages;
+    MorphShape shape;
+    uint16_t width;
+    uint16_t words;
+    uint32_t last_mask;
+    BitImage in;                // Chunk being read
+    uint16_t next;              // Its next unread row
+    bool last;                  // The view ends with it
+    uint32_t carry[IMAGE_ROW_WORDS];    // First pass output into the second
+    uint32_t out[IMAGE_ROW_WORDS];
+    uint32_t cycles;            // DWT cycles spent in Next(), for the caller to take
+} MorphStream;
+
+void MorphStream_Begin(MorphStream *ms, MorphOp op, MorphShape shape, uint16_t width);
+void MorphStream_Add(MorphStream *ms, const BitImage *rows, bool last);
+// The next filtered row as a one-row view with its frame y; valid until the
+// next call. MORPH_NONE hands out the source rows themselves.
+bool MorphStream_Next(MorphStream *ms, BitImage *row);
+
+#endif // MORPHOLOGY_H
@@ -0,0 +1,140 @@
+// pyramid.c
+#include "pyramid.h"
+#include "vision_timing.h"
+#include <string.h>
+
+#define HALF_FIRST_ROW  (PYRAMID_HALF_HEIGHT - PYRAMID_HALF_ROWS)
+
+// ============================================================================
+// Reduction
+// ============================================================================
+
+// Packs the even bits of a word into its low 16 bits
+static uint32_t even_bits(uint32_t x)
+{
+    x &= 0x55555555U;
+    x = (x | (x >> 1)) & 0x33333333U;
+    x = (x | (x >> 2)) & 0x0F0F0F0FU;
+    x = (x | (x >> 4)) & 0x00FF00FFU;
+    x = (x | (x >> 8)) & 0x0000FFFFU;
+    return x;
+}
+
+// Two rows of one level into one row of the next. Pixels 2i and 2i + 1 share
+// a word, so each output pixel is decided in even bit 2i, then the even bits
+// are packed: 32 pixels in, 16 out, no per-pixel work.
+//   OR:         any of the 4 set
+//   Majority:   two set in a column, or one in each column
+static void reduce_rows(uint32_t *out, const uint32_t *a, const uint32_t *b, uint32_t in_words)
+{
+    for (uint32_t w = 0; w < in_words; w += 2) {
+        uint32_t packed = 0;
+        for (uint32_t k = 0; k < 2 && w + k < in_words; k++) {
+#if PYRAMID_MAJORITY
+            uint32_t both = a[w + k] & b[w + k];
+            uint32_t any = a[w + k] | b[w + k];
+            uint32_t m = both | (both >> 1) | (any & (any >> 1));
+#else
+            uint32_t any = a[w + k] | b[w + k];
+            uint32_t m = any | (any >> 1);
+#endif
+            packed |= even_bits(m) << (16 * k);
+        }
+        out[w / 2] = packed;
+    }
+}
+
+// One pass down a full-frame view: every pair of its rows gives a 160-wide
+// row, every pair of those an 80-wide row. Rows past the view or, with bands
+// set, outside the frame's bands read as empty.
+void Pyramid_Build(Pyramid *pyr, const BitImage *img, const FrameDescriptor *bands)
+{
+    static const uint32_t empty[IMAGE_ROW_WORDS];
+    uint32_t start = DWT->CYCCNT;
+    uint32_t half[2][PYRAMID_HALF_WORDS];
+
+    for (uint16_t y = 0; y < PYRAMID_HALF_HEIGHT; y++) {
+        const uint32_t *pair[2];
+        for (uint16_t k = 0; k < 2; k++) {
+            uint16_t r = 2 * y + k;
+            bool valid = r < img->height && (!bands || FramePool_HasRow(bands, img->y + r));
+            pair[k] = valid ? BitImage_Row(img, r) : empty;
+        }
+        uint32_t *h = half[y & 1];
+
+        reduce_rows(h, pair[0], pair[1], IMAGE_ROW_WORDS);
+        if (y >= HALF_FIRST_ROW) memcpy(pyr->half[y - HALF_FIRST_ROW], h, sizeof(half[0]));
+        if (y & 1) reduce_rows(pyr->quarter[y / 2], half[0], half[1], PYRAMID_HALF_WORDS);
+    }
+
+    VisionTiming_Record(&vision_timing.pyramid, start);
+}
+
+// ============================================================================
+// Coarse-To-Fine Search
+// ============================================================================
+
+// Adds 1 per set pixel to counts[x - x0] for columns [x0, x1) of a level row
+static void count_columns(uint16_t *counts, const uint32_t *row, uint16_t x0, uint16_t x1)
+{
+    for (uint32_t w = x0 / 32; w <= (uint32_t)(x1 - 1) / 32; w++) {
+        uint32_t bits = row[w];
+        while (bits) {
+            uint32_t x = w * 32 + __CLZ(__RBIT(bits));
+            if (x >= x0 && x < x1) counts[x - x0]++;
+            bits &= bits - 1;
+        }
+    }
+}
+
+// Finds the line on the 80x60 level (highest column, grown while the
+// neighbours stay at half its height), re-centres it on the near rows of the
+// 160-wide level inside that region only, and returns a full-resolution
+// centre and search half-width for the row searches.
+bool Pyramid_FindLine(const Pyramid *pyr, int32_t *offset_q8, uint16_t *window)
+{
+    BitImage quarter = Pyramid_Quarter(pyr);
+    BitImage half = Pyramid_Half(pyr);
+    uint16_t coarse[PYRAMID_QUARTER_WIDTH] = {0};
+
+    for (uint16_t y = 0; y < quarter.height; y++) {
+        count_columns(coarse, BitImage_Row(&quarter, y), 0, quarter.width);
+    }
+
+    uint16_t peak_x = 0;
+    for (uint16_t x = 1; x < PYRAMID_QUARTER_WIDTH; x++) {
+        if (coarse[x] > coarse[peak_x]) peak_x = x;
+    }
+    if (coarse[peak_x] < PYRAMID_MIN_HEIGHT) return false;
+
+    uint16_t half_peak = (coarse[peak_x] + 1) / 2;
+    uint16_t left = peak_x;
+    uint16_t right = peak_x;
+    while (left > 0 && coarse[left - 1] >= half_peak) left--;
+    while (right < PYRAMID_QUARTER_WIDTH - 1 && coarse[right + 1] >= half_peak) right++;
+
+    // The same region on the 160-wide level, one pixel of slack each side
+    uint16_t x0 = (left > 0) ? 2 * left - 1 : 0;
+    uint16_t x1 = 2 * right + 3;
+    if (x1 > PYRAMID_HALF_WIDTH) x1 = PYRAMID_HALF_WIDTH;
+
+    uint16_t fine[PYRAMID_HALF_WIDTH];
+    memset(fine, 0, (uint32_t)(x1 - x0) * sizeof(fine[0]));
+    for (uint16_t y = 0; y < half.height; y++) {
+        count_columns(fine, BitImage_Row(&half, y), x0, x1);
+    }
+
+    uint32_t mass = 0;
+    uint32_t moment = 0;
+    for (uint16_t x = x0; x < x1; x++) {
+        mass += fine[x - x0];
+        moment += (uint32_t)x * fine[x - x0];
+    }
+
+    // Half-level pixel x spans full-resolution pixels [2x, 2x + 2)
+    uint32_t centre_q8 = mass ? ((moment * 512U) / mass + 256U)
+                              : ((uint32_t)(left + right + 1) * 512U);
+    *offset_q8 = (int32_t)centre_q8 - (IMAGE_WIDTH / 2) * 256;
+    *window = (uint16_t)((right - left + 1) * 2 + PYRAMID_MARGIN);
+    return true;
+}
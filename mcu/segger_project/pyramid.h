@@ -0,0 +1,50 @@
+// pyramid.h
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include "bit_image.h"
+#include <stdbool.h>
+
+// Downsampled copies of a frame in the same packed format: each pixel of a
+// level stands for a 2x2 block of the level below (OR, or at least 2 of 4
+// with PYRAMID_MAJORITY). The 160x120 level is kept only for its lower
+// PYRAMID_HALF_ROWS rows, the ones nearest the robot, which keeps the whole
+// pyramid under 2 KB.
+//
+// Pyramid_FindLine() seeds the searches that run on a complete frame while
+// the tracker has no lock: the sparse scan lines, and the full-frame shape
+// fit. The full-frame heading fit and projection are streamed band by band
+// and never see a coarse result.
+#define PYRAMID_HALF_WIDTH      (IMAGE_WIDTH / 2)
+#define PYRAMID_HALF_HEIGHT     (IMAGE_HEIGHT / 2)
+#define PYRAMID_HALF_WORDS      5                       // Per row
+#define PYRAMID_QUARTER_WIDTH   (IMAGE_WIDTH / 4)
+#define PYRAMID_QUARTER_HEIGHT  (IMAGE_HEIGHT / 4)
+#define PYRAMID_QUARTER_WORDS   3                       // 80 pixels, the last word half used
+
+typedef struct {
+    uint32_t half[PYRAMID_HALF_ROWS][PYRAMID_HALF_WORDS];          // 160-wide rows, from PYRAMID_HALF_HEIGHT - PYRAMID_HALF_ROWS
+    uint32_t quarter[PYRAMID_QUARTER_HEIGHT][PYRAMID_QUARTER_WORDS]; // 80x60, whole frame
+} Pyramid;
+
+void Pyramid_Build(Pyramid *pyr, const BitImage *img, const FrameDescriptor *bands);
+bool Pyramid_FindLine(const Pyramid *pyr, int32_t *offset_q8, uint16_t *window);
+
+// The levels as views, so any kernel can run on them. The half level's y is
+// the first level row it keeps.
+static inline BitImage Pyramid_Half(const Pyramid *pyr)
+{
+    BitImage level = BitImage_Make((uint32_t *)pyr->half, PYRAMID_HALF_WIDTH, PYRAMID_HALF_ROWS, PYRAMID_HALF_WORDS);
+    level.y = PYRAMID_HALF_HEIGHT - PYRAMID_HALF_ROWS;
+    return level;
+}
+
+static inline BitImage Pyramid_Quarter(const Pyramid *pyr)
+{
+    return BitImage_Make((uint32_t *)pyr->quarter, PYRAMID_QUARTER_WIDTH, PYRAMID_QUARTER_HEIGHT, PYRAMID_QUARTER_WORDS);
+}
+
+#endif // PYRAMID_H
@@ -0,0 +1,151 @@
+// row_runs.c
+#include "row_runs.h"
+#include "bit_kernels.h"
+
+// Finds every black/white transition of row r of a view by jumping between
+// them: each step is one RBIT/CLZ on the word, with the word inverted after
+// each transition so the next search looks for the opposite colour. Empty and
+// full words cost one compare, so a row with a line across it costs about
+// 10 words plus 2 steps per run. Returns the number of runs in the row; only
+// the first max_runs are written.
+uint16_t RowRuns_ExtractRow(const BitImage *img, uint16_t r, RowRun *runs, uint16_t max_runs)
+{
+    return RowRuns_ExtractSpan(img, r, 0, img->width, runs, max_runs);
+}
+
+// Same, but only for pixels [x0, x1): only the words the span touches are
+// read, and runs crossing its ends are cut there. Positions are in view
+// coordinates.
+uint16_t RowRuns_ExtractSpan(const BitImage *img, uint16_t r, uint16_t x0, uint16_t x1, RowRun *runs, uint16_t max_runs)
+{
+    const uint32_t *row = BitImage_Row(img, r);
+    uint16_t n = 0;
+    uint16_t start = 0;
+    bool in_run = false;
+
+    if (x1 > img->width) x1 = img->width;
+    if (x0 >= x1) return 0;
+
+    for (uint32_t w = x0 / 32; w <= (uint32_t)(x1 - 1) / 32; w++) {
+        uint32_t base = w * 32;
+        uint32_t lo = (x0 > base) ? x0 - base : 0;
+        uint32_t hi = (x1 < base + 32) ? x1 - base : 32;
+        uint32_t word = row[w] & BitKernel_SpanMask(lo, hi);
+        uint32_t bits = in_run ? ~word : word;
+        uint32_t pos = 0;
+
+        // Searching for the colour we're not in; nothing found = no transition
+        while (pos < 32) {
+            uint32_t ahead = bits & (0xFFFFFFFFU << pos);
+            if (ahead == 0) break;
+
+            pos = RowRuns_Ctz(ahead);
+            if (in_run) {
+                if (n < max_runs) {
+                    runs[n].start = start;
+                    runs[n].length = (uint16_t)(base + pos - start);
+                }
+                n++;
+            } else {
+                start = (uint16_t)(base + pos);
+            }
+            in_run = !in_run;
+            bits = ~bits;
+        }
+    }
+
+    if (in_run) {
+        if (n < max_runs) {
+            runs[n].start = start;
+            runs[n].length = (uint16_t)(x1 - start);
+        }
+        n++;
+    }
+    return n;
+}
+
+// Runs of every row of a view into one packed list, row r of the list being
+// row r of the view. A row that doesn't fit is cut short and every row after
+// it is left empty, with truncated set. With bands set, rows outside the
+// frame's bands hold stale data and are left empty too.
+void RowRuns_Extract(RowRunList *list, const BitImage *img, const FrameDescriptor *bands)
+{
+    uint16_t num_rows = (img->height > IMAGE_HEIGHT) ? IMAGE_HEIGHT : img->height;
+
+    list->first_row = img->y;
+    list->num_rows = num_rows;
+    list->num_runs = 0;
+    list->truncated = false;
+
+    for (uint16_t r = 0; r < num_rows; r++) {
+        list->row_index[r] = list->num_runs;
+        if (list->truncated) continue;
+        if (bands && !FramePool_HasRow(bands, img->y + r)) continue;
+
+        uint16_t room = ROW_RUNS_MAX - list->num_runs;
+        uint16_t n = RowRuns_ExtractRow(img, r, &list->runs[list->num_runs], room);
+        if (n > room) {
+            list->truncated = true;
+            n = room;
+        }
+        list->num_runs += n;
+    }
+    list->row_index[num_rows] = list->num_runs;
+}
+
+// Runs of every row a frame actually transferred. The list spans the first
+// to the last band row; rows between bands are empty.
+void RowRuns_ExtractFrame(RowRunList *list, const FrameDescriptor *frame)
+{
+    uint16_t lo = IMAGE_HEIGHT;
+    uint16_t hi = 0;
+
+    for (uint8_t b = 0; b < frame->num_bands; b++) {
+        const FrameBand *band = &frame->bands[b];
+        if (band->num_rows == 0) continue;
+        if (band->first_row < lo) lo = band->first_row;
+        if (band->first_row + band->num_rows > hi) hi = band->first_row + band->num_rows;
+    }
+    if (lo >= hi) lo = hi = 0;
+
+    BitImage img = BitImage_Frame(frame->data);
+    BitImage span = BitImage_Rows(&img, lo, hi - lo);
+    RowRuns_Extract(list, &span, frame);
+}
+
+// Streamed building, for rows that arrive a few at a time in frame order:
+// Begin() with the list's first frame row, then AddRows() for each view of
+// full-width rows (y is its first frame row). Rows skipped over, such as
+// those between ROI bands, are empty; rows already in the list are ignored.
+void RowRuns_Begin(RowRunList *list, uint16_t first_row)
+{
+    list->first_row = first_row;
+    list->num_rows = 0;
+    list->num_runs = 0;
+    list->truncated = false;
+    list->row_index[0] = 0;
+}
+
+void RowRuns_AddRows(RowRunList *list, const BitImage *rows)
+{
+    for (uint16_t r = 0; r < rows->height; r++) {
+        uint16_t y = rows->y + r;
+        if (y >= IMAGE_HEIGHT) break;
+        if (y < list->first_row + list->num_rows) continue;
+
+        while (list->first_row + list->num_rows < y) {
+            list->row_index[++list->num_rows] = list->num_runs;
+        }
+
+        if (!list->truncated) {
+            uint16_t room = ROW_RUNS_MAX - list->num_runs;
+            uint16_t n = RowRuns_ExtractRow(rows, r, &list->runs[list->num_runs], room);
+            if (n > room) {
+                list->truncated = true;
+                n = room;
+            }
+            list->num_runs += n;
+        }
+        list->row_index[++list->num_rows] = list->num_runs;
+    }
+}
@@ -0,0 +1,52 @@
+// row_runs.h
+#ifndef ROW_RUNS_H
+#define ROW_RUNS_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include "bit_image.h"
+#include <stdbool.h>
+
+// One horizontal run of line (set) pixels: [start, start + length)
+typedef struct {
+    uint16_t start;
+    uint16_t length;
+} RowRun;
+
+// Runs of rows [first_row, first_row + num_rows), packed row after row. Row
+// first_row + r owns runs [row_index[r], row_index[r + 1]).
+typedef struct {
+    RowRun runs[ROW_RUNS_MAX];
+    uint16_t row_index[IMAGE_HEIGHT + 1];
+    uint16_t first_row;
+    uint16_t num_rows;
+    uint16_t num_runs;
+    bool truncated;             // Ran out of runs; the rows after that are empty
+} RowRunList;
+
+// Trailing zero count: bit 0 is the leftmost pixel, so this is the distance
+// to the next set pixel. RBIT + CLZ, two cycles on the M4.
+static inline uint32_t RowRuns_Ctz(uint32_t w)
+{
+    return __CLZ(__RBIT(w));
+}
+
+uint16_t RowRuns_ExtractRow(const BitImage *img, uint16_t r, RowRun *runs, uint16_t max_runs);
+uint16_t RowRuns_ExtractSpan(const BitImage *img, uint16_t r, uint16_t x0, uint16_t x1, RowRun *runs, uint16_t max_runs);
+void RowRuns_Extract(RowRunList *list, const BitImage *img, const FrameDescriptor *bands);
+void RowRuns_ExtractFrame(RowRunList *list, const FrameDescriptor *frame);
+void RowRuns_Begin(RowRunList *list, uint16_t first_row);
+void RowRuns_AddRows(RowRunList *list, const BitImage *rows);
+
+static inline uint16_t RowRuns_Count(const RowRunList *list, uint16_t r)
+{
+    return list->row_index[r + 1] - list->row_index[r];
+}
+
+static inline const RowRun *RowRuns_Row(const RowRunList *list, uint16_t r)
+{
+    return &list->runs[list->row_index[r]];
+}
+
+#endif // ROW_RUNS_H
@@ -0,0 +1,123 @@
+// scan_lines.c
+#include "scan_lines.h"
+#include "bit_kernels.h"
+#include "row_runs.h"
+#include "vision_timing.h"
+#include <string.h>
+
+// rows lists the lookahead rows nearest first. On each row the run kept is
+// the one nearest the previous row's line, starting from seed_q8 (usually
+// last frame's offset). Runs outside the HEADING_MIN_RUN..HEADING_MAX_RUN
+// width limits don't count. Rows are frame rows; those outside the
+// full-width view img or, with bands set, outside the frame's bands are
+// skipped. A non-zero window limits the run search to that many pixels
+// around the previous row's line; the white count still reads the whole row.
+void ScanLines_Analyse(ScanLines *scan, const BitImage *img, const FrameDescriptor *bands,
+                       const uint8_t *rows, uint8_t num_rows, int32_t seed_q8, uint16_t window)
+{
+    uint32_t start = DWT->CYCCNT;
+    int32_t track_q1 = (seed_q8 >> 7) + IMAGE_WIDTH;
+    if (track_q1 < 0) track_q1 = 0;
+    if (track_q1 > 2 * IMAGE_WIDTH) track_q1 = 2 * IMAGE_WIDTH;
+
+    memset(scan, 0, sizeof(*scan));
+    if (num_rows > SCAN_LINES_MAX) num_rows = SCAN_LINES_MAX;
+
+    for (uint8_t i = 0; i < num_rows; i++) {
+        uint8_t y = rows[i];
+        if (y < img->y || y >= img->y + img->height) continue;
+        if (bands && !FramePool_HasRow(bands, y)) continue;
+
+        uint16_t r = y - img->y;
+        BitImage row = BitImage_Rows(img, r, 1);
+        uint8_t k = scan->num_rows++;
+        scan->row[k] = y;
+        scan->line_pixels += BitKernel_PopcountImage(&row);
+
+        RowRun runs[HEADING_ROW_RUNS];
+        uint16_t n;
+        if (window) {
+            int32_t x = track_q1 / 2;
+            uint16_t x0 = (x > window) ? (uint16_t)(x - window) : 0;
+            n = RowRuns_ExtractSpan(img, r, x0, (uint16_t)(x + window + 1), runs, HEADING_ROW_RUNS);
+        } else {
+            n = RowRuns_ExtractRow(img, r, runs, HEADING_ROW_RUNS);
+        }
+        if (n > HEADING_ROW_RUNS) continue;     // Noise, not a line
+
+        int32_t best_dist = INT32_MAX;
+        for (uint16_t j = 0; j < n; j++) {
+            if (runs[j].length < HEADING_MIN_RUN || runs[j].length > HEADING_MAX_RUN) continue;
+
+            int32_t centre_q1 = 2 * runs[j].start + runs[j].length;
+            int32_t dist = centre_q1 - track_q1;
+            if (dist < 0) dist = -dist;
+            if (dist < best_dist) {
+                best_dist = dist;
+                scan->offset_q8[k] = (centre_q1 - IMAGE_WIDTH) * 128;
+                scan->width[k] = runs[j].length;
+                scan->found[k] = true;
+            }
+        }
+        if (scan->found[k]) {
+            track_q1 = (scan->offset_q8[k] >> 7) + IMAGE_WIDTH;
+            scan->num_found++;
+        }
+    }
+
+    VisionTiming_Record(&vision_timing.scan_lines, start);
+}
+
+// The same LineEstimate the projection gives, so the controller doesn't care
+// which mode produced it. Offset and width are averages over the rows the
+// line was found on; confidence is the share of rows it was found on.
+void ScanLines_Estimate(const ScanLines *scan, LineEstimate *est)
+{
+    memset(est, 0, sizeof(*est));
+    if (scan->num_found < SCAN_LINES_MIN_FOUND) return;
+
+    int32_t offset_sum = 0;
+    uint32_t width_sum = 0;
+    for (uint8_t k = 0; k < scan->num_rows; k++) {
+        if (!scan->found[k]) continue;
+        offset_sum += scan->offset_q8[k];
+        width_sum += scan->width[k];
+    }
+
+    est->offset_q8 = offset_sum / scan->num_found;
+    est->width_q8 = (width_sum * 256U) / scan->num_found;
+    est->confidence_q8 = (uint16_t)((scan->num_found * 256U) / scan->num_rows);
+    est->peak_column = (uint16_t)((est->offset_q8 + (IMAGE_WIDTH / 2) * 256) >> 8);
+    est->found = true;
+}
+
+// The line on the floor through the nearest and farthest rows it was found
+// on that see the floor
+bool ScanLines_Ground(const ScanLines *scan, GroundLine *line)
+{
+    GroundPoint near, far;
+    bool have_near = false, have_far = false;
+
+    for (uint8_t k = 0; k < scan->num_rows; k++) {
+        if (!scan->found[k] || !Ground_RowValid(scan->row[k])) continue;
+        if (!have_near) {
+            have_near = Ground_Point(scan->row[k], scan->offset_q8[k], &near);
+        } else {
+            have_far = Ground_Point(scan->row[k], scan->offset_q8[k], &far);
+        }
+    }
+    if (!have_far) {
+        memset(line, 0, sizeof(*line));
+        return false;
+    }
+    return Ground_Line(&near, &far, line);
+}
+
+// White pixels scaled from the scanned rows up to frame_rows, so the
+// full-frame thresholds still apply
+uint32_t ScanLines_WhitePixels(const ScanLines *scan, uint16_t frame_rows)
+{
+    if (scan->num_rows == 0) return 0;
+    uint32_t white = (uint32_t)scan->num_rows * IMAGE_WIDTH - scan->line_pixels;
+    return (white * frame_rows) / scan->num_rows;
+}
@@ -0,0 +1,31 @@
+// scan_lines.h
+#ifndef SCAN_LINES_H
+#define SCAN_LINES_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include "line_projection.h"
+#include "bit_image.h"
+#include "ground.h"
+#include <stdbool.h>
+
+// Line position on a handful of lookahead rows only. Reads just those rows'
+// words, so a frame costs a few hundred cycles instead of a full pass.
+typedef struct {
+    uint8_t row[SCAN_LINES_MAX];
+    int32_t offset_q8[SCAN_LINES_MAX];  // Line centre minus image centre, + = right
+    uint16_t width[SCAN_LINES_MAX];     // Pixels
+    bool found[SCAN_LINES_MAX];
+    uint8_t num_rows;                   // Rows the frame actually had
+    uint8_t num_found;
+    uint32_t line_pixels;               // Set pixels in those rows
+} ScanLines;
+
+void ScanLines_Analyse(ScanLines *scan, const BitImage *img, const FrameDescriptor *bands,
+                       const uint8_t *rows, uint8_t num_rows, int32_t seed_q8, uint16_t window);
+void ScanLines_Estimate(const ScanLines *scan, LineEstimate *est);
+bool ScanLines_Ground(const ScanLines *scan, GroundLine *line);
+uint32_t ScanLines_WhitePixels(const ScanLines *scan, uint16_t frame_rows);
+
+#endif // SCAN_LINES_H
@@ -0,0 +1,249 @@
+// spi.c
+#include "spi.h"
+#include "main.h"
+
+DMA_HandleTypeDef hdma_spi1_rx;
+
+volatile bool spi_rx_half_complete = false;
+volatile bool spi_rx_full_complete = false;
+volatile bool spi_rx_error = false;
+volatile uint8_t spi_rx_bands_done = 0;
+uint32_t spi_rx_band_info[ROI_MAX_BANDS];
+uint32_t spi_rx_band_crc[ROI_MAX_BANDS];
+uint32_t spi_rx_band_time[ROI_MAX_BANDS];
+
+// Band list of the frame being received, walked from the DMA ISR
+static FrameDescriptor *rx_frame = NULL;
+static uint8_t rx_band = 0;
+static uint32_t rx_band_bytes = 0;      // Payload of the band in flight, trailer excluded
+static volatile uint32_t rx_bytes_done = 0; // Bytes of the bands already finished
+static uint32_t rx_flags = 0;           // Header flags shared by every band
+
+// Busy-wait bound for the header exchange, ~100x the 32 SCK periods it takes
+#define SPI_HEADER_SPIN_LIMIT 10000U
+
+// ============================================================================
+// DMA Setup
+// ============================================================================
+
+// SPI1_RX is routed to DMA2 Channel 3 (request 4) on the STM32L432.
+// Must run before HAL_SPI_Init() so the handle is linked when SPI1 starts.
+void SPI1_DMA_Init(void)
+{
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    hdma_spi1_rx.Instance = DMA2_Channel3;
+    hdma_spi1_rx.Init.Request = DMA_REQUEST_4;
+    hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma_spi1_rx.Init.Mode = DMA_NORMAL;
+    hdma_spi1_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+
+    if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK) {
+        Error_Handler();
+    }
+
+    __HAL_LINKDMA(&hspi1, hdmarx, hdma_spi1_rx);
+
+    // The SPI capture preempts everything else (see docs/spi_control_handshake.md)
+    HAL_NVIC_SetPriority(DMA2_Channel3_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Channel3_IRQn);
+
+    // HAL enables the SPI error interrupt during DMA reception
+    HAL_NVIC_SetPriority(SPI1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(SPI1_IRQn);
+}
+
+// ============================================================================
+// Band Requests
+// ============================================================================
+
+static const uint16_t spi_cs_pins[NUM_CAMERAS] = { SPI_CS_LEFT_PIN, SPI_CS_RIGHT_PIN };
+
+void SPI1_Select(FrameSource source)
+{
+    GPIOA->BRR = spi_cs_pins[source];
+}
+
+// Only one FPGA is ever selected, so deselect them all
+void SPI1_Deselect(void)
+{
+    GPIOA->BSRR = SPI_CS_LEFT_PIN | SPI_CS_RIGHT_PIN;
+}
+
+// Clocks the 32-bit band request out on MOSI. SPI1 is configured RX-only for
+// the DMA data phase, so the header is a short polled full-duplex exchange
+// done at register level; the HAL handle never sees it. CS must already be
+// low. flags are SPI_HEADER_LAST_BAND / SPI_HEADER_PATTERN. Returns false if
+// the peripheral never finished.
+bool SPI1_Send_Band_Header(const FrameBand *band, uint32_t flags)
+{
+    uint32_t header = ((uint32_t)band->first_row << SPI_HEADER_FIRST_ROW_POS)
+                    | ((uint32_t)band->num_rows << SPI_HEADER_NUM_ROWS_POS)
+                    | flags;
+    uint32_t spin = SPI_HEADER_SPIN_LIMIT;
+    bool ok = true;
+
+    SPI1->CR1 &= ~SPI_CR1_SPE;
+    SPI1->CR1 &= ~SPI_CR1_RXONLY;
+    SPI1->CR1 |= SPI_CR1_SPE;
+
+    // The TX FIFO holds both halfwords, low half goes out first
+    *(__IO uint16_t *)&SPI1->DR = (uint16_t)header;
+    *(__IO uint16_t *)&SPI1->DR = (uint16_t)(header >> 16);
+
+    // Whatever the FPGA drives on MISO during the header is don't-care
+    for (int i = 0; i < 2 && ok; i++) {
+        while (!(SPI1->SR & SPI_SR_RXNE) && --spin) {}
+        ok = (spin != 0);
+        (void)*(__IO uint16_t *)&SPI1->DR;
+    }
+    while ((SPI1->SR & SPI_SR_BSY) && --spin) {}
+
+    SPI1->CR1 &= ~SPI_CR1_SPE;
+    SPI1->CR1 |= SPI_CR1_RXONLY;
+    return ok && spin != 0;
+}
+
+// Called from thread context to start a frame, then from the DMA ISR for
+// every following band
+static HAL_StatusTypeDef start_band(void)
+{
+    const FrameBand *band = &rx_frame->bands[rx_band];
+
+    SPI1_Select((FrameSource)rx_frame->source);
+    uint32_t flags = rx_flags;
+    if (rx_band + 1 == rx_frame->num_bands) flags |= SPI_HEADER_LAST_BAND;
+
+    if (!SPI1_Send_Band_Header(band, flags)) {
+        SPI1_Deselect();
+        return HAL_TIMEOUT;
+    }
+    spi_rx_band_time[rx_band] = DWT->CYCCNT;
+
+    // The trailer rides in the same transfer, landing after the last row
+    rx_band_bytes = (uint32_t)band->num_rows * IMAGE_ROW_BYTES;
+    spi_rx_half_complete = false;
+    return HAL_SPI_Receive_DMA(&hspi1, rx_frame->data + (uint32_t)band->first_row * IMAGE_ROW_BYTES,
+                               (rx_band_bytes + FRAME_TRAILER_BYTES) / SPI_RX_FRAME_BYTES);
+}
+
+static HAL_StatusTypeDef start_frame(FrameDescriptor *frame, uint32_t flags)
+{
+    rx_flags = flags;
+    rx_frame = frame;
+    rx_band = 0;
+    rx_bytes_done = 0;
+    spi_rx_bands_done = 0;
+    spi_rx_full_complete = false;
+    return start_band();
+}
+
+// Reads frame->bands[] from the FPGA named by frame->source into the matching
+// rows of frame->data, one CS-framed request per band. In RX-only master mode SCK runs as soon as
+// SPE is set, so only call this once frame_ready is high.
+HAL_StatusTypeDef SPI1_Receive_Bands_DMA(FrameDescriptor *frame)
+{
+    return start_frame(frame, 0);
+}
+
+// Same transfer, but the FPGA answers with its fixed test pattern instead of
+// the frame buffer (see SPI1_Pattern_Word()). Used for link-rate calibration;
+// frame_ready is not needed.
+HAL_StatusTypeDef SPI1_Receive_Pattern_DMA(FrameDescriptor *frame)
+{
+    return start_frame(frame, SPI_HEADER_PATTERN);
+}
+
+// SPI1 clock divider, one of SPI_BAUDRATEPRESCALER_x. BR may only change with
+// the peripheral disabled, which it is between transfers.
+void SPI1_Set_Prescaler(uint32_t prescaler)
+{
+    SPI1->CR1 &= ~SPI_CR1_SPE;
+    MODIFY_REG(SPI1->CR1, SPI_CR1_BR, prescaler);
+    hspi1.Init.BaudRatePrescaler = prescaler;
+}
+
+// Payload bytes landed so far across all bands of the current frame, in
+// arrival order, trailers excluded. CNDTR counts down as bytes reach RAM,
+// so this needs no interrupt.
+uint32_t SPI1_Bytes_Received(void)
+{
+    __disable_irq();
+    uint32_t bytes = rx_bytes_done;
+    if (!spi_rx_full_complete && rx_frame != NULL) {
+        uint32_t landed = rx_band_bytes + FRAME_TRAILER_BYTES
+                        - __HAL_DMA_GET_COUNTER(&hdma_spi1_rx) * SPI_RX_FRAME_BYTES;
+        bytes += (landed < rx_band_bytes) ? landed : rx_band_bytes;
+    }
+    __enable_irq();
+    return bytes;
+}
+
+// Raising CS also drops the FPGA back to waiting for a header, so the next
+// request always starts cleanly
+void SPI1_Abort_DMA(void)
+{
+    HAL_SPI_Abort(&hspi1);
+    SPI1_Deselect();
+    rx_frame = NULL;
+    spi_rx_half_complete = false;
+    spi_rx_full_complete = false;
+}
+
+// ============================================================================
+// Interrupt Handlers & HAL Callbacks
+// ============================================================================
+
+void DMA2_Channel3_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdma_spi1_rx);
+}
+
+void SPI1_IRQHandler(void)
+{
+    HAL_SPI_IRQHandler(&hspi1);
+}
+
+void HAL_SPI_RxHalfCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi->Instance == SPI1) {
+        spi_rx_half_complete = true;
+    }
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi->Instance == SPI1) {
+        SPI1_Deselect();
+        if (rx_frame == NULL) return;
+
+        // Take the trailer before the next band can overwrite it
+        const FrameBand *band = &rx_frame->bands[rx_band];
+        const uint32_t *trailer = (const uint32_t *)(rx_frame->data + (uint32_t)band->first_row * IMAGE_ROW_BYTES
+                                                     + rx_band_bytes);
+        spi_rx_band_info[rx_band] = trailer[0];
+        spi_rx_band_crc[rx_band] = trailer[1];
+        spi_rx_bands_done = rx_band + 1;
+
+        rx_bytes_done += rx_band_bytes;
+        if (++rx_band < rx_frame->num_bands) {
+            if (start_band() != HAL_OK) {
+                spi_rx_error = true;
+            }
+        } else {
+            spi_rx_full_complete = true;
+        }
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi->Instance == SPI1) {
+        SPI1_Deselect();
+        spi_rx_error = true;
+    }
+}
@@ -0,0 +1,58 @@
+// spi.h
+#ifndef SPI_H
+#define SPI_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include <stdbool.h>
+
+// A full-frame read moves one complete binary frame from the FPGA
+#define SPI_RX_BUFFER_BYTES IMAGE_SIZE_BYTES
+// SPI1 runs 16-bit frames, so the DMA counts halfwords
+#define SPI_RX_FRAME_BYTES  2
+
+// Band request header, sent LSB first on MOSI right after CS falls
+#define SPI_HEADER_FIRST_ROW_POS 0
+#define SPI_HEADER_NUM_ROWS_POS  8
+#define SPI_HEADER_LAST_BAND     (1UL << 16)
+#define SPI_HEADER_PATTERN       (1UL << 17)
+
+// Info word sent after each band's payload, ahead of the CRC
+#define SPI_INFO_SEQUENCE(info)  ((uint16_t)(info))         // FPGA bank swaps
+#define SPI_INFO_AGE_US(info)    ((uint16_t)((info) >> 16)) // Saturates at 0xFFFF
+
+// Test pattern word at SPRAM word address addr (row * 20 + word in row),
+// must match pattern_word() in fpga/src/frame_buffer_spram.sv
+static inline uint16_t SPI1_Pattern_Word(uint32_t addr)
+{
+    return (uint16_t)((((~addr) & 0xFFU) << 8 | (addr & 0xFFU)) ^ 0x5555U);
+}
+
+extern SPI_HandleTypeDef hspi1;
+extern DMA_HandleTypeDef hdma_spi1_rx;
+
+// Raised from the DMA / SPI interrupt context, consumed by the foreground.
+// spi_rx_full_complete is only set once the last band has landed.
+extern volatile bool spi_rx_half_complete;
+extern volatile bool spi_rx_full_complete;
+extern volatile bool spi_rx_error;
+
+// Trailer of each finished band, and DWT->CYCCNT when its header went out
+// (when the FPGA latched the info word), valid for the first spi_rx_bands_done
+extern volatile uint8_t spi_rx_bands_done;
+extern uint32_t spi_rx_band_info[ROI_MAX_BANDS];
+extern uint32_t spi_rx_band_crc[ROI_MAX_BANDS];
+extern uint32_t spi_rx_band_time[ROI_MAX_BANDS];
+
+void SPI1_DMA_Init(void);
+void SPI1_Select(FrameSource source);
+void SPI1_Deselect(void);
+bool SPI1_Send_Band_Header(const FrameBand *band, uint32_t flags);
+void SPI1_Set_Prescaler(uint32_t prescaler);
+HAL_StatusTypeDef SPI1_Receive_Bands_DMA(FrameDescriptor *frame);
+HAL_StatusTypeDef SPI1_Receive_Pattern_DMA(FrameDescriptor *frame);
+uint32_t SPI1_Bytes_Received(void);
+void SPI1_Abort_DMA(void);
+
+#endif // SPI_H
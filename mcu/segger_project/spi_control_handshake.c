@@ -0,0 +1,724 @@
+// spi_control_handshake.c
+#include "spi_control_handshake.h"
+#include "spi.h"
+#include "main.h"
+#include <string.h>
+
+// The parallel-pin fallback never touches the SPI link, so none of this,
+// the calibration buffer included, is built with CAPTURE_PARALLEL
+#if !CAPTURE_PARALLEL
+
+typedef enum {
+    CAPTURE_IDLE,       // No transfer armed or running
+    CAPTURE_ARMED,      // Waiting for frame_ready and a free bus
+    CAPTURE_RECEIVING   // DMA is filling dma_frame, band by band
+} CaptureState;
+
+// One camera/FPGA pair. Both share SPI1, so at most one is RECEIVING.
+typedef struct {
+    volatile CaptureState state;
+    FrameDescriptor *dma_frame;         // Armed on / owned by the DMA
+    FrameDescriptor *ready_frame;       // Completed, nobody has taken it yet
+    uint32_t sequence;                  // Last FPGA frame number, unwrapped
+    bool have_sequence;
+    uint16_t ready_pin;                 // frame_ready input on GPIOA
+
+    // Supervision, all in DWT cycles
+    volatile uint32_t state_since;      // When the current state was entered
+    uint32_t last_frame_time;           // When the last frame completed
+
+    // Region of interest applied to every new capture
+    FrameBand roi_bands[ROI_MAX_BANDS];
+    uint8_t roi_num_bands;
+    uint16_t roi_rows;
+
+    // Link rate, and the error count it is watched against
+    uint32_t prescaler;                 // SPI_BAUDRATEPRESCALER_x
+    uint32_t link_window_start;         // DWT cycles
+    uint32_t link_window_errors;
+
+    // Calibration in progress: one test transfer per turn on the bus
+    bool calibrating;
+    uint8_t cal_rate;                   // link_prescalers[] index under test
+    uint8_t cal_repeat;                 // Clean transfers at that rate so far
+
+    SpiHandshakeStats stats;
+} CaptureSource;
+
+static CaptureSource sources[NUM_CAMERAS];
+static volatile int8_t bus_owner = -1;  // Source whose transfer is on SPI1
+static volatile bool bus_testing = false; // ... and it is a calibration test
+static volatile uint32_t test_since;    // When that test started
+static uint8_t next_turn = 0;           // First source to check for the bus
+
+static uint32_t wait_timeout_cycles;
+static uint32_t transfer_timeout_cycles;
+static uint32_t stale_timeout_cycles;
+static uint32_t calibration_timeout_cycles;
+static uint32_t link_window_cycles;
+
+// Streaming capture, for the transfer on the bus
+static SpiBandCallback band_callback = NULL;
+static uint16_t band_rows = STREAM_BAND_ROWS;
+static uint16_t next_band_row = 0;      // Rows handed to the callback, in arrival order
+
+// CRC check of the transfer on the bus, fed to the CRC unit as rows land
+static uint8_t crc_band = 0;            // Band being fed
+static uint32_t crc_band_start = 0;     // Payload bytes before crc_band, in arrival order
+static uint32_t crc_fed = 0;            // Bytes of crc_band already fed
+
+// Link-rate candidates, slowest first. 16 is the floor: a full frame at
+// 5 MHz still fits CAPTURE_TRANSFER_TIMEOUT_MS.
+static const uint32_t link_prescalers[] = {
+    SPI_BAUDRATEPRESCALER_16,
+    SPI_BAUDRATEPRESCALER_8,
+    SPI_BAUDRATEPRESCALER_4,
+    SPI_BAUDRATEPRESCALER_2
+};
+#define NUM_LINK_RATES (sizeof(link_prescalers) / sizeof(link_prescalers[0]))
+
+// Calibration transfers land here, never in the pool
+static uint32_t cal_buffer[(CALIBRATION_ROWS * IMAGE_ROW_BYTES + FRAME_TRAILER_BYTES) / 4];
+static FrameDescriptor cal_frame;
+
+// ============================================================================
+// Internal Helpers
+// ============================================================================
+
+// Hands every complete chunk up to rows_done (counted in arrival order across
+// the ROI bands) to the callback. A chunk never straddles two ROI bands, so
+// the last chunk of each band may be short.
+static void dispatch_bands(CaptureSource *src, uint16_t rows_done)
+{
+    if (band_callback == NULL) return;
+
+    FrameDescriptor *frame = src->dma_frame;
+    while (next_band_row < rows_done) {
+        const FrameBand *band = frame->bands;
+        uint16_t band_start = 0;
+        while (next_band_row >= band_start + band->num_rows) {
+            band_start += band->num_rows;
+            band++;
+        }
+
+        uint16_t offset = next_band_row - band_start;
+        uint16_t rows = band_rows;
+        if (rows > band->num_rows - offset) rows = band->num_rows - offset;
+        if (next_band_row + rows > rows_done) return;
+
+        frame->valid_bytes = (uint32_t)(next_band_row + rows) * IMAGE_ROW_BYTES;
+        band_callback(frame, band->first_row + offset, rows);
+        next_band_row += rows;
+    }
+}
+
+// Feeds the rows that landed since the last call to the CRC unit and checks
+// each band against its trailer once the band is complete. The unit is set
+// up (CRC_Init() in main.c) to bit-reverse each input word, so it sees the
+// bits in wire order, which is the order the FPGA ran its CRC in. Returns
+// false on a mismatch.
+static bool check_crc(CaptureSource *src, uint32_t bytes_done)
+{
+    const FrameDescriptor *frame = src->dma_frame;
+
+    while (crc_band < frame->num_bands) {
+        const FrameBand *band = &frame->bands[crc_band];
+        uint32_t band_bytes = (uint32_t)band->num_rows * IMAGE_ROW_BYTES;
+        uint32_t landed = bytes_done - crc_band_start;
+        if (landed > band_bytes) landed = band_bytes;
+
+        const uint32_t *p = (const uint32_t *)(frame->data + (uint32_t)band->first_row * IMAGE_ROW_BYTES
+                                               + crc_fed);
+        for (; crc_fed + 4 <= landed; crc_fed += 4) {
+            CRC->DR = *p++;
+        }
+        if (crc_fed < band_bytes || spi_rx_bands_done <= crc_band) return true;
+
+        // The info word is covered too, so the sequence and age are trusted
+        CRC->DR = spi_rx_band_info[crc_band];
+        if (CRC->DR != spi_rx_band_crc[crc_band]) return false;
+        CRC->CR |= CRC_CR_RESET;
+        crc_band_start += band_bytes;
+        crc_fed = 0;
+        crc_band++;
+    }
+    return true;
+}
+
+// Called from the EXTI ISR or with interrupts disabled
+static void start_transfer(uint8_t s)
+{
+    CaptureSource *src = &sources[s];
+
+    EXTI->IMR1 &= ~src->ready_pin;
+    bus_owner = (int8_t)s;
+    next_band_row = 0;
+    crc_band = 0;
+    crc_band_start = 0;
+    crc_fed = 0;
+    CRC->CR |= CRC_CR_RESET;
+    src->state = CAPTURE_RECEIVING;
+    src->state_since = DWT->CYCCNT;
+    SPI1_Set_Prescaler(src->prescaler);
+    if (SPI1_Receive_Bands_DMA(src->dma_frame) != HAL_OK) {
+        spi_rx_error = true;
+    }
+}
+
+// One pattern transfer at the rate under test. The pattern needs no
+// frame_ready, so it can go as soon as the bus is free. Called from the EXTI
+// ISR or with interrupts disabled.
+static void start_test(uint8_t s)
+{
+    CaptureSource *src = &sources[s];
+
+    bus_owner = (int8_t)s;
+    bus_testing = true;
+    test_since = DWT->CYCCNT;
+    cal_frame.source = s;
+    SPI1_Set_Prescaler(link_prescalers[src->cal_rate]);
+    if (SPI1_Receive_Pattern_DMA(&cal_frame) != HAL_OK) {
+        spi_rx_error = true;
+    }
+}
+
+// Gives a free bus to the next source that is calibrating, or is armed and
+// its FPGA holds a frame; a calibrating source runs its next test instead of
+// a frame. The turn rotates, so with both cameras streaming the transfers
+// alternate and neither side waits more than one transfer for the bus.
+// Called from the EXTI ISR or with interrupts disabled.
+static void schedule(void)
+{
+    if (bus_owner >= 0) return;
+
+    for (uint8_t i = 0; i < NUM_CAMERAS; i++) {
+        uint8_t s = (next_turn + i) % NUM_CAMERAS;
+        if (sources[s].calibrating && sources[s].state != CAPTURE_RECEIVING) {
+            next_turn = (s + 1) % NUM_CAMERAS;
+            start_test(s);
+            return;
+        }
+        if (sources[s].state == CAPTURE_ARMED && (GPIOA->IDR & sources[s].ready_pin)) {
+            next_turn = (s + 1) % NUM_CAMERAS;
+            start_transfer(s);
+            return;
+        }
+    }
+}
+
+static void schedule_safe(void)
+{
+    __disable_irq();
+    schedule();
+    __enable_irq();
+}
+
+// Every band starts with a header under a fresh chip select, so raising CS is
+// enough to put the FPGA back in a known state. frame_ready stays high until
+// the last band has been read, so re-arming restarts on the same frame if the
+// FPGA still holds it.
+static void resync(uint8_t s)
+{
+    SPI1_Abort_DMA();
+    sources[s].stats.resyncs++;
+
+    sources[s].state = CAPTURE_IDLE;
+    bus_owner = -1;
+    SpiControlHandshake_BeginCapture((FrameSource)s);
+    schedule_safe();
+}
+
+// Whether the finished test transfer matches SPI1_Pattern_Word() word for
+// word and the FPGA's CRC agrees, so both the data and the trailer path are
+// exercised
+static bool pattern_ok(void)
+{
+    const uint16_t *words = (const uint16_t *)cal_buffer;
+
+    for (uint32_t i = 0; i < CALIBRATION_ROWS * IMAGE_ROW_BYTES / 2; i++) {
+        if (words[i] != SPI1_Pattern_Word(i)) return false;
+    }
+
+    CRC->CR |= CRC_CR_RESET;
+    for (uint32_t i = 0; i < CALIBRATION_ROWS * IMAGE_ROW_WORDS; i++) {
+        CRC->DR = cal_buffer[i];
+    }
+    CRC->DR = spi_rx_band_info[0];
+    return CRC->DR == spi_rx_band_crc[0];
+}
+
+// Starts a calibration from the slowest rate. The tests go through
+// schedule() like frame transfers, one at a time, so the other camera keeps
+// its turns on the bus.
+static void request_calibration(uint8_t s)
+{
+    CaptureSource *src = &sources[s];
+
+    if (src->calibrating) return;
+    src->cal_rate = 0;
+    src->cal_repeat = 0;
+    src->calibrating = true;
+    schedule_safe();
+}
+
+// Takes one test result. A rate passes after CALIBRATION_REPEATS clean
+// tests, and the rate is stepped up from the slowest candidate until a test
+// fails. It then settles LINK_MARGIN_STEPS below the fastest clean rate so it
+// is not sitting on the edge. If even the slowest rate fails (FPGA missing or
+// unpowered) that is what is kept.
+static void calibration_step(uint8_t s, bool passed)
+{
+    CaptureSource *src = &sources[s];
+
+    if (passed) {
+        if (++src->cal_repeat < CALIBRATION_REPEATS) return;
+        src->cal_repeat = 0;
+        if (++src->cal_rate < NUM_LINK_RATES) return;
+    }
+
+    // cal_rate rates passed
+    uint8_t rate = 0;
+    if (src->cal_rate == NUM_LINK_RATES) {
+        rate = src->cal_rate - 1;   // Never saw a failure, no edge to keep away from
+    } else if (src->cal_rate > LINK_MARGIN_STEPS) {
+        rate = src->cal_rate - 1 - LINK_MARGIN_STEPS;
+    }
+    src->prescaler = link_prescalers[rate];
+    src->stats.link_prescaler = src->prescaler;
+    src->stats.calibrations++;
+    src->link_window_start = DWT->CYCCNT;
+    src->link_window_errors = src->stats.crc_errors + src->stats.rx_errors + src->stats.frames_partial;
+    // Waiting behind the tests was not a missed frame
+    src->state_since = DWT->CYCCNT;
+    src->calibrating = false;
+}
+
+// Finishes the test on the bus once the DMA is done, has failed, or has run
+// past CALIBRATION_TIMEOUT_MS, then hands the bus on. Never waits.
+static void service_test(uint8_t s)
+{
+    bool passed;
+
+    if (spi_rx_error) {
+        passed = false;
+    } else if (spi_rx_full_complete) {
+        passed = pattern_ok();
+    } else if (DWT->CYCCNT - test_since > calibration_timeout_cycles) {
+        passed = false;
+    } else {
+        return;
+    }
+
+    SPI1_Abort_DMA();
+    spi_rx_error = false;
+    calibration_step(s, passed);
+
+    bus_testing = false;
+    bus_owner = -1;
+    schedule_safe();
+}
+
+// Recalibrates a source whose link errors climb by LINK_ERROR_THRESHOLD
+// within one LINK_ERROR_WINDOW_MS. The tests wait for a free bus rather
+// than cutting a transfer short.
+static void check_link(uint8_t s, uint32_t now)
+{
+    CaptureSource *src = &sources[s];
+    uint32_t errors = src->stats.crc_errors + src->stats.rx_errors + src->stats.frames_partial;
+
+    if (src->calibrating) return;
+    if (errors - src->link_window_errors >= LINK_ERROR_THRESHOLD) {
+        request_calibration(s);
+    } else if (now - src->link_window_start > link_window_cycles) {
+        src->link_window_start = now;
+        src->link_window_errors = errors;
+    }
+}
+
+// Fills in the frame's FPGA sequence number and timing from the info word
+// of its first band. The FPGA counts in 16 bits, so the count is unwrapped
+// against the last frame from the same source.
+static void stamp_frame(CaptureSource *src, FrameDescriptor *frame)
+{
+    uint32_t info = spi_rx_band_info[0];
+    uint16_t seq = SPI_INFO_SEQUENCE(info);
+
+    if (src->have_sequence) {
+        src->sequence += (uint16_t)(seq - (uint16_t)src->sequence);
+    } else {
+        src->sequence = seq;
+        src->have_sequence = true;
+    }
+
+    // A bank swap between two bands hands out the next frame's rows
+    for (uint8_t b = 1; b < frame->num_bands; b++) {
+        if (SPI_INFO_SEQUENCE(spi_rx_band_info[b]) != seq) {
+            src->stats.frames_torn++;
+            break;
+        }
+    }
+
+    frame->sequence = src->sequence;
+    frame->started_at = spi_rx_band_time[0];
+    frame->exposed_at = frame->started_at - SPI_INFO_AGE_US(info) * (SystemCoreClock / 1000000U);
+    frame->timestamp = src->last_frame_time;
+}
+
+static void complete_frame(uint8_t s)
+{
+    CaptureSource *src = &sources[s];
+
+    spi_rx_full_complete = false;
+    spi_rx_half_complete = false;
+
+    // Corrupted on the wire: reuse the buffer for the next frame
+    if (!check_crc(src, (uint32_t)src->roi_rows * IMAGE_ROW_BYTES)) {
+        src->stats.crc_errors++;
+        src->state = CAPTURE_IDLE;
+        bus_owner = -1;
+        schedule_safe();
+        SpiControlHandshake_BeginCapture((FrameSource)s);
+        return;
+    }
+
+    src->stats.frames_received++;
+    src->last_frame_time = DWT->CYCCNT;
+    stamp_frame(src, src->dma_frame);
+    dispatch_bands(src, src->roi_rows);
+    src->dma_frame->valid_bytes = (uint32_t)src->roi_rows * IMAGE_ROW_BYTES;
+
+    // Control task never took the previous frame; newest one wins
+    if (src->ready_frame != NULL) {
+        FramePool_Release(src->ready_frame);
+        src->stats.frames_dropped++;
+    }
+    src->ready_frame = src->dma_frame;
+    src->dma_frame = NULL;
+
+    // Hand the bus on (the other side has the turn), then re-arm this side so
+    // its frame N+1 transfers while frame N is processed
+    src->state = CAPTURE_IDLE;
+    bus_owner = -1;
+    schedule_safe();
+    SpiControlHandshake_BeginCapture((FrameSource)s);
+}
+
+// Consumes the flags raised by the DMA ISR for the transfer on the bus and
+// enforces its deadline. For a frame it also checks the CRC and, in
+// streaming mode, hands out the rows received so far.
+static void service_bus(uint32_t now)
+{
+    int8_t owner = bus_owner;
+
+    if (owner < 0) return;
+    if (bus_testing) {
+        service_test(owner);
+        return;
+    }
+
+    CaptureSource *src = &sources[owner];
+
+    if (spi_rx_error) {
+        spi_rx_error = false;
+        src->stats.rx_errors++;
+        resync(owner);
+    } else if (spi_rx_full_complete) {
+        complete_frame(owner);
+    } else if (now - src->state_since > transfer_timeout_cycles) {
+        // SCK stalled or the FPGA stopped answering: throw the frame away
+        src->stats.frames_partial++;
+        resync(owner);
+    } else {
+        uint32_t bytes_done = SPI1_Bytes_Received();
+        if (check_crc(src, bytes_done)) {
+            dispatch_bands(src, bytes_done / IMAGE_ROW_BYTES);
+        } else {
+            // A bad band poisons the frame; stop now and re-read it
+            src->stats.crc_errors++;
+            resync(owner);
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void SpiControlHandshake_Init(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    static const uint16_t ready_pins[NUM_CAMERAS] = { FRAME_READY_LEFT_PIN, FRAME_READY_RIGHT_PIN };
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+
+    // frame_ready from each FPGA doubles as the DMA start trigger
+    GPIO_InitStruct.Pin = FRAME_READY_LEFT_PIN | FRAME_READY_RIGHT_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+    GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+    // Only listen to the edges while a capture is armed
+    EXTI->IMR1 &= ~(FRAME_READY_LEFT_PIN | FRAME_READY_RIGHT_PIN);
+    __HAL_GPIO_EXTI_CLEAR_IT(FRAME_READY_LEFT_PIN | FRAME_READY_RIGHT_PIN);
+
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 1);
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+    uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+    wait_timeout_cycles = CAPTURE_WAIT_TIMEOUT_MS * cycles_per_ms;
+    transfer_timeout_cycles = CAPTURE_TRANSFER_TIMEOUT_MS * cycles_per_ms;
+    stale_timeout_cycles = FRAME_STALE_TIMEOUT_MS * cycles_per_ms;
+    calibration_timeout_cycles = CALIBRATION_TIMEOUT_MS * cycles_per_ms;
+    link_window_cycles = LINK_ERROR_WINDOW_MS * cycles_per_ms;
+
+    memset(&cal_frame, 0, sizeof(cal_frame));
+    cal_frame.data = (uint8_t *)cal_buffer;
+    cal_frame.bands[0].first_row = 0;
+    cal_frame.bands[0].num_rows = CALIBRATION_ROWS;
+    cal_frame.num_bands = 1;
+
+    FramePool_Init();
+    memset(sources, 0, sizeof(sources));
+    for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+        sources[s].state = CAPTURE_IDLE;
+        sources[s].ready_pin = ready_pins[s];
+        sources[s].last_frame_time = DWT->CYCCNT;
+        sources[s].prescaler = hspi1.Init.BaudRatePrescaler;
+        sources[s].stats.link_prescaler = sources[s].prescaler;
+        sources[s].link_window_start = DWT->CYCCNT;
+        SpiControlHandshake_SetRoi((FrameSource)s, NULL, 0);
+    }
+    bus_owner = -1;
+    next_turn = 0;
+}
+
+// Picks the fastest reliable SPI rate for each camera from the FPGA test
+// pattern. Runs the tests back to back and blocks for a few tens of ms, so
+// call it once at boot after Init() and before the first BeginCapture().
+// Service() reruns it on its own, one test per pass, when a camera's link
+// errors climb.
+void SpiControlHandshake_Calibrate(void)
+{
+    bool busy = true;
+
+    for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+        request_calibration(s);
+    }
+    while (busy) {
+        service_bus(DWT->CYCCNT);
+        busy = false;
+        for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+            if (sources[s].calibrating) busy = true;
+        }
+    }
+}
+
+// Streams each frame to the callback every rows_per_band rows while it is
+// still being received; frame->source tells the cameras apart. Pass NULL to
+// go back to whole-frame delivery only.
+void SpiControlHandshake_SetBandCallback(SpiBandCallback callback, uint16_t rows_per_band)
+{
+    band_callback = callback;
+    band_rows = (rows_per_band == 0) ? STREAM_BAND_ROWS : rows_per_band;
+}
+
+// Restricts every following capture from this source to the given row bands.
+// Bands are clipped to the image, then read top to bottom with overlapping
+// or touching bands merged, so a band's CRC trailer (which lands on the row
+// after it) only ever hits a row that is not read or not read yet. NULL or
+// zero bands restores the full frame. Takes effect from the next capture
+// that is armed.
+void SpiControlHandshake_SetRoi(FrameSource source, const FrameBand *bands, uint8_t num_bands)
+{
+    CaptureSource *src = &sources[source];
+    uint8_t n = 0;
+    uint16_t rows = 0;
+
+    if (num_bands > ROI_MAX_BANDS) num_bands = ROI_MAX_BANDS;
+    for (uint8_t i = 0; bands != NULL && i < num_bands; i++) {
+        if (bands[i].first_row >= IMAGE_HEIGHT || bands[i].num_rows == 0) continue;
+        uint16_t first = bands[i].first_row;
+        uint16_t end = first + bands[i].num_rows;
+        if (end > IMAGE_HEIGHT) end = IMAGE_HEIGHT;
+
+        // Insertion sort by first row
+        uint8_t j = n;
+        while (j > 0 && src->roi_bands[j - 1].first_row > first) {
+            src->roi_bands[j] = src->roi_bands[j - 1];
+            j--;
+        }
+        src->roi_bands[j].first_row = (uint8_t)first;
+        src->roi_bands[j].num_rows = (uint8_t)(end - first);
+        n++;
+    }
+
+    // Merge neighbours that overlap or touch
+    uint8_t merged = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        uint16_t first = src->roi_bands[i].first_row;
+        uint16_t end = first + src->roi_bands[i].num_rows;
+        if (merged > 0) {
+            FrameBand *prev = &src->roi_bands[merged - 1];
+            uint16_t prev_end = prev->first_row + prev->num_rows;
+            if (first <= prev_end) {
+                if (end > prev_end) prev->num_rows = (uint8_t)(end - prev->first_row);
+                continue;
+            }
+        }
+        src->roi_bands[merged++] = src->roi_bands[i];
+    }
+    n = merged;
+    for (uint8_t i = 0; i < n; i++) rows += src->roi_bands[i].num_rows;
+
+    if (n == 0) {
+        src->roi_bands[0].first_row = 0;
+        src->roi_bands[0].num_rows = IMAGE_HEIGHT;
+        rows = IMAGE_HEIGHT;
+        n = 1;
+    }
+    src->roi_num_bands = n;
+    src->roi_rows = rows;
+}
+
+// Arms a frame from the pool for this source. The transfer itself starts
+// from the frame_ready edge (or immediately if a frame is already waiting)
+// as soon as the shared bus is free, so this never blocks. Does nothing if a
+// capture is already in flight or if every frame is owned; ReleaseFrame()
+// restarts it in that case.
+void SpiControlHandshake_BeginCapture(FrameSource source)
+{
+    CaptureSource *src = &sources[source];
+
+    if (src->state != CAPTURE_IDLE) return;
+
+    if (src->dma_frame == NULL) {
+        src->dma_frame = FramePool_Acquire();
+        if (src->dma_frame == NULL) return;
+    }
+    src->dma_frame->valid_bytes = 0;
+    src->dma_frame->source = source;
+    memcpy(src->dma_frame->bands, src->roi_bands, sizeof(src->roi_bands));
+    src->dma_frame->num_bands = src->roi_num_bands;
+
+    __disable_irq();
+    src->state = CAPTURE_ARMED;
+    src->state_since = DWT->CYCCNT;
+    __HAL_GPIO_EXTI_CLEAR_IT(src->ready_pin);
+    EXTI->IMR1 |= src->ready_pin;
+
+    // FPGA may already hold an unread frame, so no edge will come
+    schedule();
+    __enable_irq();
+}
+
+// Services the transfer on the bus (see service_bus()), enforces the
+// per-state deadlines of every source and starts a recalibration where the
+// link errors climb. Call once per main loop pass; it never blocks, and the
+// bands are only as fresh as the polling rate.
+void SpiControlHandshake_Service(void)
+{
+    uint32_t now = DWT->CYCCNT;
+
+    service_bus(now);
+
+    for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+        CaptureSource *src = &sources[s];
+
+        switch (src->state) {
+        case CAPTURE_IDLE:
+            // Pool was exhausted last time round; try again
+            SpiControlHandshake_BeginCapture((FrameSource)s);
+            break;
+
+        case CAPTURE_ARMED:
+            // The EXTI may move us to RECEIVING at any time
+            __disable_irq();
+            // A calibrating source is not reading frames
+            if (src->state == CAPTURE_ARMED && !src->calibrating
+                && now - src->state_since > wait_timeout_cycles) {
+                src->stats.frames_missed++;
+                src->state_since = now;
+            }
+            __enable_irq();
+            break;
+
+        case CAPTURE_RECEIVING:
+            break;
+        }
+
+        check_link(s, now);
+    }
+}
+
+// Single entry point for one side's control loop. Returns within one
+// Service() pass: FRAME hands over a new frame from that camera (release it
+// with ReleaseFrame()), STALE means keep acting on the last one, TIMEOUT
+// means nothing from that camera for FRAME_STALE_TIMEOUT_MS and that side
+// should fail safe.
+//
+// A frame that completed during the other side's Poll() is handed out
+// before the bus is serviced again. With both sides polled every pass, each
+// frame is taken before any chunk of a later transfer reaches the band
+// callback, so state the callback builds for one frame (main.c's shared run
+// list) is still that frame's when it is processed.
+SpiCaptureStatus SpiControlHandshake_Poll(FrameSource source, FrameDescriptor **frame)
+{
+    *frame = SpiControlHandshake_GetFrame(source);
+    if (*frame != NULL) return SPI_CAPTURE_FRAME;
+
+    SpiControlHandshake_Service();
+
+    *frame = SpiControlHandshake_GetFrame(source);
+    if (*frame != NULL) return SPI_CAPTURE_FRAME;
+
+    if (DWT->CYCCNT - sources[source].last_frame_time > stale_timeout_cycles) {
+        return SPI_CAPTURE_TIMEOUT;
+    }
+    return SPI_CAPTURE_STALE;
+}
+
+bool SpiControlHandshake_FrameReady(FrameSource source)
+{
+    return sources[source].ready_frame != NULL;
+}
+
+// Hands the newest completed frame from this source, and its pool reference,
+// to the caller. The DMA never touches it again until every owner has
+// released it.
+FrameDescriptor *SpiControlHandshake_GetFrame(FrameSource source)
+{
+    FrameDescriptor *frame = sources[source].ready_frame;
+    sources[source].ready_frame = NULL;
+    return frame;
+}
+
+// Either side may have been paused on an empty pool, so retry both
+void SpiControlHandshake_ReleaseFrame(FrameDescriptor *frame)
+{
+    FramePool_Release(frame);
+    for (uint8_t s = 0; s < NUM_CAMERAS; s++) {
+        SpiControlHandshake_BeginCapture((FrameSource)s);
+    }
+}
+
+const SpiHandshakeStats *SpiControlHandshake_GetStats(FrameSource source)
+{
+    return &sources[source].stats;
+}
+
+// ============================================================================
+// Interrupt Handler
+// ============================================================================
+
+void EXTI15_10_IRQHandler(void)
+{
+    uint32_t pending = EXTI->PR1 & (FRAME_READY_LEFT_PIN | FRAME_READY_RIGHT_PIN);
+
+    if (pending) {
+        __HAL_GPIO_EXTI_CLEAR_IT(pending);
+        schedule();
+    }
+}
+
+#endif // !CAPTURE_PARALLEL
@@ -0,0 +1,52 @@
+// spi_control_handshake.h
+#ifndef SPI_CONTROL_HANDSHAKE_H
+#define SPI_CONTROL_HANDSHAKE_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include <stdbool.h>
+
+// Kept per camera
+typedef struct {
+    uint32_t frames_received;   // Completed DMA transfers
+    uint32_t frames_dropped;    // Ready frames replaced before being taken
+    uint32_t rx_errors;         // SPI / DMA errors (transfer restarted)
+    uint32_t frames_missed;     // frame_ready did not rise within the deadline
+    uint32_t frames_partial;    // Transfers aborted at the transfer deadline
+    uint32_t resyncs;           // Transfers aborted and restarted from a new header
+    uint32_t crc_errors;        // Frames rejected on a band CRC mismatch
+    uint32_t frames_torn;       // Bands of one frame came from different FPGA frames
+    uint32_t calibrations;      // Link-rate calibrations run
+    uint32_t link_prescaler;    // SPI_BAUDRATEPRESCALER_x this camera is read at
+} SpiHandshakeStats;
+
+// What the control loop gets from SpiControlHandshake_Poll(), never blocking
+typedef enum {
+    SPI_CAPTURE_FRAME,          // A new frame was handed out
+    SPI_CAPTURE_STALE,          // No new frame yet, the last one is still recent
+    SPI_CAPTURE_TIMEOUT         // Nothing for FRAME_STALE_TIMEOUT_MS, fail safe
+} SpiCaptureStatus;
+
+// Partial-frame callback: rows [first_row, first_row + num_rows) of the frame
+// being received are valid. Rows are image rows; with a ROI they skip the
+// gaps between bands. Runs from SpiControlHandshake_Service().
+typedef void (*SpiBandCallback)(const FrameDescriptor *frame, uint16_t first_row, uint16_t num_rows);
+
+// Not built with CAPTURE_PARALLEL, which reads the camera through
+// camera_capture.h instead
+#if !CAPTURE_PARALLEL
+void SpiControlHandshake_Init(void);
+void SpiControlHandshake_SetBandCallback(SpiBandCallback callback, uint16_t rows_per_band);
+void SpiControlHandshake_Calibrate(void);
+void SpiControlHandshake_SetRoi(FrameSource source, const FrameBand *bands, uint8_t num_bands);
+void SpiControlHandshake_BeginCapture(FrameSource source);
+void SpiControlHandshake_Service(void);
+SpiCaptureStatus SpiControlHandshake_Poll(FrameSource source, FrameDescriptor **frame);
+bool SpiControlHandshake_FrameReady(FrameSource source);
+FrameDescriptor *SpiControlHandshake_GetFrame(FrameSource source);
+void SpiControlHandshake_ReleaseFrame(FrameDescriptor *frame);
+const SpiHandshakeStats *SpiControlHandshake_GetStats(FrameSource source);
+#endif
+
+#endif // SPI_CONTROL_HANDSHAKE_H
@@ -0,0 +1,142 @@
+// summed_area.c
+#include "summed_area.h"
+#include "bit_kernels.h"
+#include "vision_timing.h"
+#include <string.h>
+
+// ============================================================================
+// Building
+// ============================================================================
+
+void SummedArea_Clear(SummedArea *sat)
+{
+    memset(sat, 0, sizeof(*sat));
+    memset(sat->wrap_col, SAT_NO_WRAP, sizeof(sat->wrap_col));
+}
+
+// Turns the pending byte-lane counts into the next table row: the row above
+// plus the running sum of this cell row from the left
+static void finish_row(SummedArea *sat)
+{
+    uint16_t i = sat->cell_rows + 1;
+    uint32_t across = 0;
+
+    sat->wrap_col[i] = SAT_NO_WRAP;
+    for (uint32_t w = 0; w < IMAGE_ROW_WORDS; w++) {
+        uint32_t lanes = sat->pending[w];
+        for (uint32_t k = 0; k < 4; k++) {
+            uint16_t j = (uint16_t)(w * 4 + k + 1);
+            across += (lanes >> (8 * k)) & 0xFFU;
+
+            uint32_t corner = SummedArea_Corner(sat, i - 1, j) + across;
+            sat->table[i][j] = (uint16_t)corner;
+            if (corner >= 0x10000U && sat->wrap_col[i] == SAT_NO_WRAP) sat->wrap_col[i] = (uint8_t)j;
+        }
+        sat->pending[w] = 0;
+    }
+    sat->cell_rows = i;
+}
+
+// Full-width rows, in frame order; rows is a view whose y is its first frame
+// row. Each row adds one SWAR byte count per word to the pending cell row
+// (8 rows of at most 8 bits stay under a byte). Cell rows skipped over, such
+// as those between ROI bands, are finished as they are, so rows that were
+// never transferred count as empty. Rows of a cell row already finished are
+// ignored.
+void SummedArea_AddRows(SummedArea *sat, const BitImage *rows)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t words = BitImage_RowWords(rows);
+    if (words > IMAGE_ROW_WORDS) words = IMAGE_ROW_WORDS;
+
+    for (uint16_t r = 0; r < rows->height; r++) {
+        uint16_t y = rows->y + r;
+        uint16_t cell_row = y / SAT_CELL;
+        if (y >= IMAGE_HEIGHT || cell_row < sat->cell_rows) continue;
+        while (sat->cell_rows < cell_row) finish_row(sat);
+
+        const uint32_t *row = BitImage_Row(rows, r);
+        for (uint32_t w = 0; w < words; w++) {
+            sat->pending[w] += BitKernel_ByteCounts(row[w]);
+        }
+        if (y % SAT_CELL == SAT_CELL - 1) finish_row(sat);
+    }
+
+    sat->cycles += DWT->CYCCNT - start;
+}
+
+// Finishes every cell row not yet final; the table is complete after this
+void SummedArea_Finish(SummedArea *sat)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    while (sat->cell_rows < SAT_ROWS) finish_row(sat);
+
+    sat->cycles += DWT->CYCCNT - start;
+    VisionTiming_RecordCycles(&vision_timing.summed_area, sat->cycles);
+}
+
+// The rows a frame transferred, band by band. Bands are kept sorted by row.
+void SummedArea_BuildFrame(SummedArea *sat, const FrameDescriptor *frame)
+{
+    BitImage img = BitImage_Frame(frame->data);
+
+    SummedArea_Clear(sat);
+    for (uint8_t b = 0; b < frame->num_bands; b++) {
+        const FrameBand *band = &frame->bands[b];
+        if (band->num_rows == 0) continue;
+        BitImage rows = BitImage_Rows(&img, band->first_row, band->num_rows);
+        SummedArea_AddRows(sat, &rows);
+    }
+    SummedArea_Finish(sat);
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+// Line pixels in cell columns [col, col + cols) and cell rows
+// [row, row + rows), clipped to the table
+uint32_t SummedArea_Cells(const SummedArea *sat, uint16_t col, uint16_t row, uint16_t cols, uint16_t rows)
+{
+    uint32_t c0 = (col > SAT_COLS) ? SAT_COLS : col;
+    uint32_t r0 = (row > SAT_ROWS) ? SAT_ROWS : row;
+    uint32_t c1 = (c0 + cols > SAT_COLS) ? SAT_COLS : c0 + cols;
+    uint32_t r1 = (r0 + rows > SAT_ROWS) ? SAT_ROWS : r0 + rows;
+
+    return SummedArea_Corner(sat, r1, c1) - SummedArea_Corner(sat, r0, c1)
+         - SummedArea_Corner(sat, r1, c0) + SummedArea_Corner(sat, r0, c0);
+}
+
+// Pixel edges to the nearest cell edges: [first, first + count) cells
+static void snap(uint32_t x, uint32_t length, uint32_t limit, uint16_t *first, uint16_t *count)
+{
+    uint32_t lo = (x + SAT_CELL / 2) / SAT_CELL;
+    uint32_t hi = (x + length + SAT_CELL / 2) / SAT_CELL;
+    if (lo > limit) lo = limit;
+    if (hi > limit) hi = limit;
+    *first = (uint16_t)lo;
+    *count = (uint16_t)((hi > lo) ? hi - lo : 0);
+}
+
+// Line pixels in a pixel rectangle, its edges moved to the nearest cell
+// edges (up to SAT_CELL / 2 pixels each)
+uint32_t SummedArea_Sum(const SummedArea *sat, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    uint16_t col, row, cols, rows;
+    snap(x, width, SAT_COLS, &col, &cols);
+    snap(y, height, SAT_ROWS, &row, &rows);
+    return SummedArea_Cells(sat, col, row, cols, rows);
+}
+
+// Share of line pixels in the same snapped rectangle, 0 .. 256
+uint16_t SummedArea_Density_q8(const SummedArea *sat, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    uint16_t col, row, cols, rows;
+    snap(x, width, SAT_COLS, &col, &cols);
+    snap(y, height, SAT_ROWS, &row, &rows);
+
+    uint32_t area = (uint32_t)cols * rows * SAT_CELL * SAT_CELL;
+    if (area == 0) return 0;
+    return (uint16_t)((SummedArea_Cells(sat, col, row, cols, rows) * 256U) / area);
+}
@@ -0,0 +1,49 @@
+// summed_area.h
+#ifndef SUMMED_AREA_H
+#define SUMMED_AREA_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include "bit_image.h"
+
+// Cells are one byte of a row word wide, so a cell's count is a byte lane of
+// the SWAR popcount summed over its rows. Not tunable.
+#define SAT_CELL        8
+#define SAT_COLS        (IMAGE_WIDTH / SAT_CELL)
+#define SAT_ROWS        (IMAGE_HEIGHT / SAT_CELL)
+#define SAT_NO_WRAP     0xFF
+
+// Summed-area table of line pixels over SAT_CELL x SAT_CELL cells: corner
+// (i, j) holds the line pixels in cell rows < i and cell columns < j, so any
+// cell-aligned rectangle is four reads. A frame's 76800 pixels don't fit 16
+// bits, but corners only grow along a row, so each table row crosses 65536
+// at most once; wrap_col records where and a read adds it back. That keeps
+// the table at 16 bits, 2.5 KB.
+//
+// Built a cell row at a time from rows given in frame order, so it can be
+// fed band by band; a cell row is final once its last pixel row is in.
+typedef struct {
+    uint16_t table[SAT_ROWS + 1][SAT_COLS + 1];
+    uint8_t wrap_col[SAT_ROWS + 1];         // First column at or past 65536, SAT_NO_WRAP = none
+    uint32_t pending[IMAGE_ROW_WORDS];      // Byte-lane counts of the cell row being summed
+    uint16_t cell_rows;                     // Table rows finished
+    uint32_t cycles;                        // DWT cycles spent on this frame so far
+} SummedArea;
+
+void SummedArea_Clear(SummedArea *sat);
+void SummedArea_AddRows(SummedArea *sat, const BitImage *rows);
+void SummedArea_Finish(SummedArea *sat);
+void SummedArea_BuildFrame(SummedArea *sat, const FrameDescriptor *frame);
+
+uint32_t SummedArea_Cells(const SummedArea *sat, uint16_t col, uint16_t row, uint16_t cols, uint16_t rows);
+uint32_t SummedArea_Sum(const SummedArea *sat, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+uint16_t SummedArea_Density_q8(const SummedArea *sat, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+// Line pixels in cell rows < i, cell columns < j
+static inline uint32_t SummedArea_Corner(const SummedArea *sat, uint16_t i, uint16_t j)
+{
+    return sat->table[i][j] + ((j >= sat->wrap_col[i]) ? 0x10000U : 0U);
+}
+
+#endif // SUMMED_AREA_H
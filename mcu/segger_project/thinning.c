@@ -0,0 +1,278 @@
+// thinning.c
+#include "thinning.h"
+#include "row_runs.h"
+#include "bit_kernels.h"
+#include "vision_timing.h"
+#include <string.h>
+
+#define ROW_MASK_WORDS  ((IMAGE_HEIGHT + 31) / 32)
+
+// Rows are worked on as copies padded with a word either side, so the
+// neighbour shifts need no bounds checks. Index 0 and words + 1 are the pads.
+#define PADDED_WORDS    (IMAGE_ROW_WORDS + 2)
+
+// ============================================================================
+// Word Ops
+// ============================================================================
+
+// A view row into a padded copy. Pixels past either end repeat the end
+// pixel, as rows past the top and bottom repeat the end rows: a line that
+// runs out of the view keeps going instead of ending there, so its
+// centreline runs straight to the edge instead of forking into the corners.
+static void load_row(uint32_t *dst, const uint32_t *src, uint32_t words, uint16_t width, uint32_t last_mask)
+{
+    memcpy(dst + 1, src, words * sizeof(uint32_t));
+    dst[words] &= last_mask;
+    dst[words + 1] = 0;
+    dst[0] = (dst[1] & 1U) << 31;
+
+    uint32_t last = (uint32_t)width - 1;
+    uint32_t end_bit = (dst[1 + last / 32] >> (last % 32)) & 1U;
+    dst[1 + width / 32] |= end_bit << (width % 32);
+}
+
+// Bit-sliced sum of eight masks: bit i of the result is b0 + 2 b1 + 4 b2 +
+// 8 b3 for pixel i. Carry-save adders, 4 full and 2 half.
+static inline void count8(const uint32_t in[8], uint32_t b[4])
+{
+    uint32_t s1 = in[0] ^ in[1] ^ in[2];
+    uint32_t c1 = (in[0] & in[1]) | (in[2] & (in[0] ^ in[1]));
+    uint32_t s2 = in[3] ^ in[4] ^ in[5];
+    uint32_t c2 = (in[3] & in[4]) | (in[5] & (in[3] ^ in[4]));
+    uint32_t s3 = s1 ^ s2 ^ in[6];
+    uint32_t c3 = (s1 & s2) | (in[6] & (s1 ^ s2));
+    uint32_t c4 = s3 & in[7];
+    uint32_t s5 = c1 ^ c2 ^ c3;
+    uint32_t c5 = (c1 & c2) | (c3 & (c1 ^ c2));
+    uint32_t c6 = s5 & c4;
+
+    b[0] = s3 ^ in[7];
+    b[1] = s5 ^ c4;
+    b[2] = c5 ^ c6;
+    b[3] = c5 & c6;
+}
+
+// ============================================================================
+// Passes
+// ============================================================================
+
+// Pixels of one row that one Zhang-Suen sub-iteration removes. With the
+// neighbours P2 (north) clockwise to P9 (north-west), a set pixel goes if
+//   2 <= B <= 6     B = set neighbours
+//   A == 1          A = 0 -> 1 steps around P2, P3, ..., P9, P2
+//   first:  P2 P4 P6 == 0 and P4 P6 P8 == 0
+//   second: P2 P4 P8 == 0 and P2 P6 P8 == 0
+// Pixel x - 1 sits one bit below x, so west neighbours are a left shift.
+// Words without a set pixel are skipped, which is most of a frame.
+static bool thin_row(uint32_t *out, const uint32_t *up, const uint32_t *here, const uint32_t *down,
+                     uint32_t words, uint32_t last_mask, bool first)
+{
+    uint32_t removed = 0;
+
+    for (uint32_t i = 1; i <= words; i++) {
+        uint32_t c = here[i];
+        if (i == words) c &= last_mask;
+        if (c == 0) continue;
+
+        uint32_t p[8];
+        p[0] = up[i];                                       // P2  N
+        p[1] = (up[i] >> 1) | (up[i + 1] << 31);            // P3  NE
+        p[2] = (here[i] >> 1) | (here[i + 1] << 31);        // P4  E
+        p[3] = (down[i] >> 1) | (down[i + 1] << 31);        // P5  SE
+        p[4] = down[i];                                     // P6  S
+        p[5] = (down[i] << 1) | (down[i - 1] >> 31);        // P7  SW
+        p[6] = (here[i] << 1) | (here[i - 1] >> 31);        // P8  W
+        p[7] = (up[i] << 1) | (up[i - 1] >> 31);            // P9  NW
+
+        uint32_t steps[8];
+        for (uint32_t k = 0; k < 8; k++) steps[k] = ~p[k] & p[(k + 1) & 7];
+
+        uint32_t b[4], a[4];
+        count8(p, b);
+        count8(steps, a);
+
+        uint32_t b_ok = (b[1] | b[2] | b[3]) & ~b[3] & ~(b[2] & b[1] & b[0]);
+        uint32_t a_ok = a[0] & ~a[1] & ~a[2] & ~a[3];
+        uint32_t side_ok = first ? ~(p[0] & p[2] & p[4]) & ~(p[2] & p[4] & p[6])
+                                 : ~(p[0] & p[2] & p[6]) & ~(p[0] & p[4] & p[6]);
+        uint32_t del = c & b_ok & a_ok & side_ok;
+        if (del) {
+            out[i - 1] &= ~del;
+            removed |= del;
+        }
+    }
+    return removed != 0;
+}
+
+static inline bool row_bit(const uint32_t *mask, int32_t r)
+{
+    return r >= 0 && r < IMAGE_HEIGHT && ((mask[r >> 5] >> (r & 31)) & 1U);
+}
+
+// One sub-iteration over the view, in place. Every pixel has to be judged on
+// the image as it was before the sub-iteration, so the rows above, at and
+// below the output row are padded copies taken before it is written, rotated
+// down one row per step as in the morphology pass. Rows are only worked on
+// if they or a neighbour changed since this sub-iteration last ran (active);
+// the rows changed now go to changed.
+static bool sub_iteration(const BitImage *img, bool first, const uint32_t *active, uint32_t *changed)
+{
+    uint32_t raw[3][PADDED_WORDS];
+    uint32_t above = 0, here = 1, below = 2;
+    uint32_t words = BitImage_RowWords(img);
+    uint32_t last_mask = BitImage_LastMask(img);
+    uint16_t num_rows = (img->height > IMAGE_HEIGHT) ? IMAGE_HEIGHT : img->height;
+    bool any = false;
+
+    memset(changed, 0, ROW_MASK_WORDS * sizeof(uint32_t));
+    if (num_rows == 0 || words == 0 || words > IMAGE_ROW_WORDS) return false;
+
+    load_row(raw[here], BitImage_Row(img, 0), words, img->width, last_mask);
+    memcpy(raw[above], raw[here], sizeof(raw[here]));
+
+    for (uint16_t r = 0; r < num_rows; r++) {
+        if (r + 1 < num_rows) {
+            load_row(raw[below], BitImage_Row(img, r + 1), words, img->width, last_mask);
+        } else {
+            memcpy(raw[below], raw[here], sizeof(raw[here]));
+        }
+
+        if (row_bit(active, r - 1) || row_bit(active, r) || row_bit(active, r + 1)) {
+            if (thin_row(BitImage_Row(img, r), raw[above], raw[here], raw[below], words, last_mask, first)) {
+                changed[r >> 5] |= 1U << (r & 31);
+                any = true;
+            }
+        }
+
+        uint32_t t = above;
+        above = here;
+        here = below;
+        below = t;
+    }
+    return any;
+}
+
+// Thins a view in place until a full iteration (both sub-iterations)
+// removes nothing, or max_iterations. A sub-iteration revisits the rows either kind changed since
+// it last ran. Returns the iterations run.
+uint8_t Thinning_Apply(const BitImage *img, uint8_t max_iterations, bool *converged)
+{
+    uint32_t changed[2][ROW_MASK_WORDS];
+    uint32_t active[ROW_MASK_WORDS];
+    uint8_t it = 0;
+    bool done = false;
+
+    memset(changed, 0xFF, sizeof(changed));
+    while (it < max_iterations && !done) {
+        bool any = false;
+        for (uint8_t half = 0; half < 2; half++) {
+            for (uint32_t i = 0; i < ROW_MASK_WORDS; i++) active[i] = changed[0][i] | changed[1][i];
+            any |= sub_iteration(img, half == 0, active, changed[half]);
+        }
+        done = !any;
+        it++;
+    }
+    if (converged) *converged = done;
+    return it;
+}
+
+// ============================================================================
+// Centreline
+// ============================================================================
+
+// Appends the centreline of a thinned view to line, nearest (last) row first:
+// one point per run, at its middle pixel, on frame rows that are a multiple
+// of row_step
+void Thinning_Points(const BitImage *img, Centreline *line, uint8_t row_step)
+{
+    if (row_step == 0) row_step = 1;
+
+    for (int32_t r = (int32_t)img->height - 1; r >= 0; r--) {
+        uint16_t y = img->y + (uint16_t)r;
+        if (y % row_step) continue;
+
+        RowRun runs[HEADING_ROW_RUNS];
+        uint16_t n = RowRuns_ExtractRow(img, (uint16_t)r, runs, HEADING_ROW_RUNS);
+        if (n > HEADING_ROW_RUNS) n = HEADING_ROW_RUNS;
+
+        for (uint16_t j = 0; j < n; j++) {
+            if (line->count >= THIN_MAX_POINTS) {
+                line->truncated = true;
+                return;
+            }
+            line->points[line->count].x = img->x + runs[j].start + (runs[j].length - 1) / 2;
+            line->points[line->count].y = y;
+            line->count++;
+        }
+    }
+}
+
+// Row y of a run list painted back into a bitmap row; rows the list doesn't
+// cover are empty
+static void paint_row(const RowRunList *list, uint16_t y, uint32_t *row)
+{
+    memset(row, 0, IMAGE_ROW_BYTES);
+    if (y < list->first_row || y - list->first_row >= list->num_rows) return;
+
+    uint16_t r = y - list->first_row;
+    const RowRun *runs = RowRuns_Row(list, r);
+    for (uint16_t j = 0; j < RowRuns_Count(list, r); j++) {
+        uint32_t x0 = runs[j].start;
+        uint32_t x1 = x0 + runs[j].length;
+        for (uint32_t w = x0 / 32; w <= (x1 - 1) / 32; w++) {
+            uint32_t lo = (x0 > w * 32) ? x0 - w * 32 : 0;
+            uint32_t hi = (x1 < w * 32 + 32) ? x1 - w * 32 : 32;
+            row[w] |= BitKernel_SpanMask(lo, hi);
+        }
+    }
+}
+
+// Thins the line of a frame from its run list and lists the centreline.
+// Each band the frame transferred is painted from the runs into scratch (an
+// IMAGE_SIZE_WORDS buffer) and thinned there as its own view, so the frame
+// itself is never written. Nearest band first, bands being kept sorted by
+// row.
+void Thinning_Runs(const RowRunList *list, const FrameDescriptor *frame, uint32_t *scratch, Centreline *line)
+{
+    uint32_t start = DWT->CYCCNT;
+    BitImage img = BitImage_Frame(scratch);
+
+    line->count = 0;
+    line->source = frame->source;
+    line->sequence = frame->sequence;
+    line->iterations = 0;
+    line->converged = true;
+    line->truncated = false;
+
+    for (int32_t b = (int32_t)frame->num_bands - 1; b >= 0; b--) {
+        const FrameBand *band = &frame->bands[b];
+        if (band->num_rows == 0) continue;
+
+        BitImage rows = BitImage_Rows(&img, band->first_row, band->num_rows);
+        for (uint16_t r = 0; r < rows.height; r++) {
+            paint_row(list, rows.y + r, BitImage_Row(&rows, r));
+        }
+
+        bool converged;
+        uint8_t it = Thinning_Apply(&rows, THIN_MAX_ITERATIONS, &converged);
+        if (it > line->iterations) line->iterations = it;
+        if (!converged) line->converged = false;
+        Thinning_Points(&rows, line, THIN_POINT_ROW_STEP);
+    }
+
+    VisionTiming_Record(&vision_timing.thinning, start);
+}
+
+// A frame that could not be thinned: the list is emptied but names the
+// frame, so the points of an earlier frame, maybe the other camera's, are
+// never read as this one's
+void Thinning_Skip(const FrameDescriptor *frame, Centreline *line)
+{
+    line->count = 0;
+    line->source = frame->source;
+    line->sequence = frame->sequence;
+    line->iterations = 0;
+    line->converged = false;
+    line->truncated = false;
+    line->skipped++;
+}
@@ -0,0 +1,44 @@
+// thinning.h
+#ifndef THINNING_H
+#define THINNING_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include "bit_image.h"
+#include "row_runs.h"
+#include <stdbool.h>
+
+// Zhang-Suen thinning on packed views, 32 pixels per word op. The eight
+// neighbours of a word are the rows above and below and all three shifted
+// by one bit; the neighbour count and the 0 -> 1 transition count are
+// added bit-sliced, so every test is a handful of word ops for 32 pixels.
+// A wide blob is peeled down to a one-pixel centreline, the same width near
+// the robot as far away.
+
+// One point of the centreline, frame pixels
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+} CentrePoint;
+
+// Centreline points nearest row first, for curve fitting: one per skeleton
+// run on every THIN_POINT_ROW_STEP-th row. source and sequence name the
+// frame the points are from.
+typedef struct {
+    CentrePoint points[THIN_MAX_POINTS];
+    uint16_t count;
+    uint8_t source;             // FrameSource of the frame
+    uint32_t sequence;          // Its frame number
+    uint32_t skipped;           // Frames left unthinned, no scratch buffer free
+    uint8_t iterations;         // Most thinning iterations any band needed
+    bool converged;             // Every band thinned fully within THIN_MAX_ITERATIONS
+    bool truncated;             // More points than THIN_MAX_POINTS
+} Centreline;
+
+uint8_t Thinning_Apply(const BitImage *img, uint8_t max_iterations, bool *converged);
+void Thinning_Points(const BitImage *img, Centreline *line, uint8_t row_step);
+void Thinning_Runs(const RowRunList *list, const FrameDescriptor *frame, uint32_t *scratch, Centreline *line);
+void Thinning_Skip(const FrameDescriptor *frame, Centreline *line);
+
+#endif // THINNING_H
@@ -0,0 +1,239 @@
+// track_shape.c
+#include "track_shape.h"
+#include "ground.h"
+#include "vision_timing.h"
+#include <string.h>
+
+// ============================================================================
+// Accumulation
+// ============================================================================
+
+// seed_q8 is where the line is expected on the nearest row, as an offset from
+// the image centre (the tracker's prediction, as for the heading fit)
+void TrackShape_Clear(ShapeFit *fit, int32_t seed_q8)
+{
+    memset(fit, 0, sizeof(*fit));
+
+    int32_t seed_q1 = (seed_q8 >> 7) + IMAGE_WIDTH;
+    if (seed_q1 < 0) seed_q1 = 0;
+    if (seed_q1 > 2 * IMAGE_WIDTH) seed_q1 = 2 * IMAGE_WIDTH;
+    fit->track_q1 = seed_q1;
+    fit->last_row = -1;
+    fit->line_row = -1;
+    fit->examined_row = IMAGE_HEIGHT;
+    fit->bar_row = -1;
+    fit->bar_top = -1;
+    fit->gap_row = -1;
+}
+
+// Takes the run nearest the line followed so far: zero distance if the run
+// covers it, which is what a bar across the line does. Past the first row a
+// run more than SHAPE_GATE pixels away, plus one per row since the line was
+// last seen, is something else and the row counts as empty. A run at least
+// SHAPE_BAR_FACTOR line widths (and SHAPE_BAR_MIN) long is a bar: it doesn't
+// move the followed centre, so the line is picked up again past it.
+void TrackShape_AddRow(ShapeFit *fit, uint16_t y, const RowRun *runs, uint16_t num_runs)
+{
+    if (num_runs > HEADING_ROW_RUNS) return;    // Noise: neither line nor empty
+    fit->examined_row = (int16_t)y;
+
+    const RowRun *best = NULL;
+    int32_t best_dist = INT32_MAX;
+    for (uint16_t j = 0; j < num_runs; j++) {
+        if (runs[j].length < HEADING_MIN_RUN) continue;
+
+        int32_t lo = 2 * runs[j].start;
+        int32_t hi = 2 * (runs[j].start + runs[j].length);
+        int32_t dist = (fit->track_q1 < lo) ? lo - fit->track_q1
+                     : (fit->track_q1 > hi) ? fit->track_q1 - hi : 0;
+        if (dist < best_dist) {
+            best_dist = dist;
+            best = &runs[j];
+        }
+    }
+    if (fit->last_row >= 0 && best_dist > 2 * (SHAPE_GATE + fit->last_row - y - 1)) best = NULL;
+    if (best == NULL) {
+        fit->empty++;
+        return;
+    }
+
+    if (fit->last_row >= 0 && fit->empty > 0) {
+        uint16_t gap = fit->scan_rows ? fit->empty : (uint16_t)(fit->last_row - y - 1);
+        if (gap > fit->gap_rows) {
+            fit->gap_rows = gap;
+            fit->gap_row = fit->last_row;
+        }
+    }
+    fit->empty = 0;
+    fit->last_row = (int16_t)y;
+    fit->rows++;
+
+    uint32_t width = (fit->width_rows >= 2) ? fit->width_sum / fit->width_rows : 0;
+    uint32_t bar_min = (SHAPE_BAR_FACTOR * width > SHAPE_BAR_MIN) ? SHAPE_BAR_FACTOR * width : SHAPE_BAR_MIN;
+    if (best->length >= bar_min) {
+        if (fit->bar_row < 0) {
+            fit->bar_row = (int16_t)y;
+            fit->bar_open = true;
+        }
+        if (!fit->bar_open) return;             // A second bar; only the nearest counts
+
+        int32_t left = (fit->track_q1 - 2 * best->start) / 2;
+        int32_t right = (2 * (best->start + best->length) - fit->track_q1) / 2;
+        fit->bar_top = (int16_t)y;
+        if (best->length > fit->bar_length) fit->bar_length = best->length;
+        if (left > fit->bar_left) fit->bar_left = (uint16_t)left;
+        if (right > fit->bar_right) fit->bar_right = (uint16_t)right;
+        return;
+    }
+
+    int32_t centre_q1 = 2 * best->start + best->length;
+    fit->bar_open = false;
+    fit->line_row = (int16_t)y;
+    fit->track_q1 = centre_q1;
+    if (fit->width_rows < SHAPE_WIDTH_ROWS) {
+        fit->width_sum += best->length;
+        fit->width_rows++;
+    }
+
+    uint8_t zone = (uint8_t)((y * 3U) / IMAGE_HEIGHT);
+    fit->zone_x_q1[zone] += centre_q1;
+    fit->zone_y[zone] += y;
+    fit->zone_rows[zone]++;
+}
+
+// Every row of a run list, nearest first. With bands set, rows the frame
+// didn't transfer are skipped rather than taken as empty.
+void TrackShape_AddRuns(ShapeFit *fit, const RowRunList *list, const FrameDescriptor *bands)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    for (int32_t r = (int32_t)list->num_rows - 1; r >= 0; r--) {
+        uint16_t y = list->first_row + (uint16_t)r;
+        if (bands && !FramePool_HasRow(bands, y)) continue;
+        TrackShape_AddRow(fit, y, RowRuns_Row(list, (uint16_t)r), RowRuns_Count(list, (uint16_t)r));
+    }
+    if (list->truncated) fit->truncated = true;
+
+    fit->cycles += DWT->CYCCNT - start;
+}
+
+// Only the listed frame rows of a full-width view, nearest first, for frames
+// that were never turned into a run list (the sparse lookahead rows). These
+// are tens of rows apart, so one missed row would already span
+// SHAPE_GAP_ROWS: gaps and ends are counted in listed rows missed instead.
+void TrackShape_AddImageRows(ShapeFit *fit, const BitImage *img, const FrameDescriptor *bands,
+                             const uint8_t *rows, uint8_t num_rows)
+{
+    uint32_t start = DWT->CYCCNT;
+    fit->scan_rows = true;
+
+    for (uint8_t i = 0; i < num_rows; i++) {
+        uint8_t y = rows[i];
+        if (y < img->y || y >= img->y + img->height) continue;
+        if (bands && !FramePool_HasRow(bands, y)) continue;
+
+        RowRun runs[HEADING_ROW_RUNS];
+        uint16_t n = RowRuns_ExtractRow(img, y - img->y, runs, HEADING_ROW_RUNS);
+        TrackShape_AddRow(fit, y, runs, n);
+    }
+
+    fit->cycles += DWT->CYCCNT - start;
+}
+
+// ============================================================================
+// Classification
+// ============================================================================
+
+// 0 at lo up to 256 at hi
+static uint16_t ramp_q8(uint32_t v, uint32_t lo, uint32_t hi)
+{
+    if (v <= lo) return 0;
+    if (v >= hi) return 256;
+    return (uint16_t)(((v - lo) * 256U) / (hi - lo));
+}
+
+// A measure that just reached its threshold gives 0.5, twice the threshold 1
+static uint16_t margin_q8(uint32_t v, uint32_t threshold)
+{
+    return 128 + ramp_q8(v, threshold, 2 * threshold) / 2;
+}
+
+// How far the far zone's line centre sits off the straight line through the
+// near and middle zones' centres. Perspective keeps a straight floor line
+// straight in the image, so a lean alone gives no bend.
+static bool zone_bend(const ShapeFit *fit, int32_t *bend_q8)
+{
+    int32_t x[3], y[3];
+
+    for (uint8_t z = 0; z < 3; z++) {
+        if (fit->zone_rows[z] == 0) return false;
+        x[z] = (fit->zone_x_q1[z] * 128) / fit->zone_rows[z];
+        y[z] = (int32_t)((fit->zone_y[z] * 256U) / fit->zone_rows[z]);
+    }
+    if (y[1] == y[2]) return false;
+
+    int64_t far_q8 = x[1] + ((int64_t)(x[1] - x[2]) * (y[0] - y[1])) / (y[1] - y[2]);
+    *bend_q8 = x[0] - (int32_t)far_q8;
+    return true;
+}
+
+// Checked in order, first match wins: no line, a bar (cross, T, or a
+// one-sided corner the line doesn't go on past), a gap, an end (or a line
+// that runs out of the side of the frame: a curve), a bend, straight.
+void TrackShape_Estimate(ShapeFit *fit, TrackShape *shape)
+{
+    uint32_t start = DWT->CYCCNT;
+
+    memset(shape, 0, sizeof(*shape));
+    shape->feature_row = -1;
+    shape->bar_left = fit->bar_left;
+    shape->bar_right = fit->bar_right;
+
+    bool bent = zone_bend(fit, &shape->curve_q8);
+    uint32_t bend = (uint32_t)((shape->curve_q8 < 0) ? -shape->curve_q8 : shape->curve_q8) >> 8;
+    uint32_t beyond = (fit->last_row >= 0) ? (uint32_t)(fit->last_row - fit->examined_row) : 0;
+    uint32_t gap_min = SHAPE_GAP_ROWS;
+    uint32_t end_min = SHAPE_END_ROWS;
+    if (fit->scan_rows) {
+        beyond = (fit->last_row >= 0) ? fit->empty : 0;
+        gap_min = SHAPE_GAP_SCAN_ROWS;
+        end_min = SHAPE_END_SCAN_ROWS;
+    }
+
+    if (fit->rows < SHAPE_MIN_ROWS) {
+        shape->kind = TRACK_NONE;
+        shape->confidence_q8 = (fit->rows == 0) ? 256 : 128;
+    } else if (fit->bar_row >= 0) {
+        bool left = fit->bar_left >= SHAPE_ARM_MIN;
+        bool right = fit->bar_right >= SHAPE_ARM_MIN;
+        bool goes_on = fit->line_row >= 0 && fit->bar_top - fit->line_row >= SHAPE_CONTINUE_ROWS;
+
+        if (left && right) shape->kind = goes_on ? TRACK_CROSS : TRACK_T;
+        else if (goes_on) shape->kind = TRACK_T;
+        else shape->kind = left ? TRACK_CURVE_LEFT : TRACK_CURVE_RIGHT;
+        shape->feature_row = fit->bar_row;
+        shape->confidence_q8 = margin_q8(fit->bar_length, SHAPE_BAR_MIN);
+    } else if (fit->gap_rows >= gap_min) {
+        shape->kind = TRACK_GAP;
+        shape->feature_row = fit->gap_row;
+        shape->confidence_q8 = margin_q8(fit->gap_rows, gap_min);
+    } else if (beyond >= end_min) {
+        int32_t x = fit->track_q1 / 2;
+        if (x < SHAPE_EDGE) shape->kind = TRACK_CURVE_LEFT;
+        else if (x >= IMAGE_WIDTH - SHAPE_EDGE) shape->kind = TRACK_CURVE_RIGHT;
+        else shape->kind = TRACK_END;
+        shape->feature_row = fit->last_row;
+        shape->confidence_q8 = margin_q8(beyond, end_min);
+    } else if (bent && bend >= SHAPE_CURVE) {
+        shape->kind = (shape->curve_q8 > 0) ? TRACK_CURVE_RIGHT : TRACK_CURVE_LEFT;
+        shape->confidence_q8 = margin_q8(bend, SHAPE_CURVE);
+    } else {
+        shape->kind = TRACK_STRAIGHT;
+        shape->confidence_q8 = bent ? 256 - ramp_q8(bend, 0, SHAPE_CURVE) / 2 : 128;
+    }
+    if (fit->truncated) shape->confidence_q8 /= 2;
+    if (shape->feature_row >= 0) shape->feature_mm = Ground_Distance_mm((uint16_t)shape->feature_row);
+
+    fit->cycles += DWT->CYCCNT - start;
+    VisionTiming_RecordCycles(&vision_timing.shape, fit->cycles);
+}
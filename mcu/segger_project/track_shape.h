@@ -0,0 +1,73 @@
+// track_shape.h
+#ifndef TRACK_SHAPE_H
+#define TRACK_SHAPE_H
+
+#include "stm32l4xx_hal.h"
+#include "config.h"
+#include "frame_pool.h"
+#include "row_runs.h"
+#include "bit_image.h"
+#include <stdbool.h>
+
+// What the track does ahead of the robot, from one frame
+typedef enum {
+    TRACK_NONE = 0,             // No line in view
+    TRACK_STRAIGHT,
+    TRACK_CURVE_LEFT,           // Includes a corner turning left
+    TRACK_CURVE_RIGHT,
+    TRACK_CROSS,                // A bar across the line, line goes on past it
+    TRACK_T,                    // A bar the line stops at, or a branch to one side
+    TRACK_GAP,                  // Line stops and starts again further on (dashes)
+    TRACK_END                   // Line stops and doesn't come back
+} TrackKind;
+
+// Follows the line from the nearest row to the farthest, one row at a time,
+// keeping only running counts: where a bar across it starts and how far it
+// reaches, the longest empty stretch, and the line centre in a near, middle
+// and far zone for the bend. Rows must come nearest (largest y) first.
+typedef struct {
+    int32_t track_q1;                   // Line centre followed, half pixels
+    int16_t last_row;                   // Last row with the line (or a bar), -1 = none yet
+    int16_t line_row;                   // Last row with the line itself, not a bar
+    int16_t examined_row;               // Farthest row looked at
+    uint16_t rows;                      // Rows with the line or a bar
+    uint16_t empty;                     // Rows looked at without it since last_row
+    bool scan_rows;                     // Fed sparse rows: gaps and ends count rows looked at
+    uint32_t width_sum;                 // Line width over the first SHAPE_WIDTH_ROWS rows
+    uint16_t width_rows;
+
+    int16_t bar_row;                    // Nearest row of the first bar, -1 = none
+    int16_t bar_top;                    // Its farthest row
+    bool bar_open;                      // No line row since the bar's last row
+    uint16_t bar_length;                // Widest bar run, pixels
+    uint16_t bar_left, bar_right;       // How far it reaches either side of the line
+
+    uint16_t gap_rows;                  // Longest empty stretch between line rows (see scan_rows)
+    int16_t gap_row;                    // The line row before it
+
+    int32_t zone_x_q1[3];               // Centre sums: far, middle, near third
+    uint32_t zone_y[3];
+    uint16_t zone_rows[3];
+
+    bool truncated;                     // Fed from a RowRunList that ran out of runs
+    uint32_t cycles;                    // DWT cycles spent on this frame so far
+} ShapeFit;
+
+typedef struct {
+    TrackKind kind;
+    uint16_t confidence_q8;     // 0 .. 256
+    int16_t feature_row;        // Where the bar, gap or end is, -1 for none
+    uint16_t feature_mm;        // How far ahead that is on the floor, 0 = unknown
+    int32_t curve_q8;           // Far line minus the near line extended, 1/256 pixel, + = right
+    uint16_t bar_left;          // Bar reach either side of the line, pixels
+    uint16_t bar_right;
+} TrackShape;
+
+void TrackShape_Clear(ShapeFit *fit, int32_t seed_q8);
+void TrackShape_AddRow(ShapeFit *fit, uint16_t y, const RowRun *runs, uint16_t num_runs);
+void TrackShape_AddRuns(ShapeFit *fit, const RowRunList *list, const FrameDescriptor *bands);
+void TrackShape_AddImageRows(ShapeFit *fit, const BitImage *img, const FrameDescriptor *bands,
+                             const uint8_t *rows, uint8_t num_rows);
+void TrackShape_Estimate(ShapeFit *fit, TrackShape *shape);
+
+#endif // TRACK_SHAPE_H
@@ -0,0 +1,41 @@
+// vision_timing.h
+#ifndef VISION_TIMING_H
+#define VISION_TIMING_H
+
+#include "stm32l4xx_hal.h"
+
+// DWT cycles one vision stage took on its last run and its worst run so far.
+// Updated by the stages themselves on every frame, so the live watch or a
+// telemetry dump shows real-frame costs, not a synthetic benchmark.
+typedef struct {
+    uint32_t last;
+    uint32_t worst;
+    uint32_t count;
+} VisionCycles;
+
+typedef struct {
+    VisionCycles morph;         // Summed over the bands of a frame
+    VisionCycles components;
+    VisionCycles heading;       // Summed over the bands of a frame
+    VisionCycles scan_lines;
+    VisionCycles pyramid;
+    VisionCycles shape;         // Track shape classifier
+    VisionCycles summed_area;
+    VisionCycles thinning;
+} VisionTiming;
+
+extern VisionTiming vision_timing;
+
+static inline void VisionTiming_RecordCycles(VisionCycles *c, uint32_t cycles)
+{
+    c->last = cycles;
+    if (cycles > c->worst) c->worst = cycles;
+    c->count++;
+}
+
+static inline void VisionTiming_Record(VisionCycles *c, uint32_t start)
+{
+    VisionTiming_RecordCycles(c, DWT->CYCCNT - start);
+}
+
+#endif // VISION_TIMING_H